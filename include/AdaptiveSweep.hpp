@@ -0,0 +1,60 @@
+/**
+ * @file AdaptiveSweep.hpp
+ * @brief Declarations for adaptive sweeps over theta.
+ *
+ * Instead of a dense uniform grid, the sweep starts coarse and bisects only
+ * the intervals where the midpoint differs from the straight line between
+ * its neighbours by more than the tolerance. Most of the curve is smooth,
+ * so the points end up near 0 and 180 degrees, where phi and the electron
+ * energy change quickly and the asin in the phi formula nears its limits.
+ */
+
+#ifndef ADAPTIVE_SWEEP_H
+#define ADAPTIVE_SWEEP_H
+
+#include <ComptonEvent.hpp>
+#include <vector>
+
+struct AdaptiveSettings {
+	long double theta_min = 0;       // degrees
+	long double theta_max = 180;
+	std::size_t initial_steps = 17;
+	long double tolerance = 1E-4;    // relative to each column's range
+	long double min_spacing = 1E-6;  // degrees, intervals stop splitting
+	std::size_t max_points = 1 << 22;
+	unsigned threads = 0;            // 0 uses every core
+};
+
+struct AdaptiveCurve {
+	long double lambda_naught;       // picometers
+	std::vector<ComptonResultValues> rows; // in increasing theta
+	std::size_t evaluations = 0;
+	std::size_t passes = 0;
+};
+
+/**
+ * @brief refines theta for one incident wavelength. Each pass evaluates
+ * the midpoints of every interval still above the tolerance, split over
+ * settings.threads threads.
+ * @param lambda_naught the incident wavelength in picometers
+ * @param settings the range, tolerance and limits
+ */
+AdaptiveCurve adaptive_sweep(long double lambda_naught,
+			     const AdaptiveSettings &settings);
+
+/**
+ * @brief linear interpolation of one column of a curve
+ * @param curve the refined curve
+ * @param column index of the value in ComptonResultValues order
+ * @param theta the angle in degrees
+ */
+long double interpolate_curve(const AdaptiveCurve &curve, int column,
+			      long double theta);
+
+/**
+ * @brief value of a ComptonResultValues column by index (0 = theta, ...,
+ * 10 = electron_scatter_angle)
+ */
+long double result_column(const ComptonResultValues &r, int column);
+
+#endif
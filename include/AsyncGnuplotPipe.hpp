@@ -0,0 +1,85 @@
+/**
+ * @file AsyncGnuplotPipe.hpp
+ * @brief Declaration for AsyncGnuplotPipe, a gnuplot pipe that never blocks
+ * the caller (the GTK main loop).
+ *
+ * Lines are collected into a frame in memory and sendFrame() hands the
+ * frame to a writer thread through a lock-free queue. The writer thread
+ * starts gnuplot and does all of the writing, so a slow or busy gnuplot
+ * only holds up the writer. When several replaceable frames are waiting,
+ * only the newest one is written.
+ *
+ * If gnuplot can't be started or a write to it fails, the pipe is marked
+ * failed: later frames are discarded instead of queued, and the owner can
+ * check hasFailed() and start a new pipe.
+ */
+
+#ifndef ASYNC_GNUPLOT_PIPE_H
+#define ASYNC_GNUPLOT_PIPE_H
+
+#include <atomic>
+#include <cstdint>
+#include <semaphore.h>
+#include <stdio.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+class AsyncGnuplotPipe {
+private:
+	struct Frame {
+		std::string text;
+		bool replaceable;
+		Frame *next;
+	};
+
+	// frames waiting for the writer, newest first. Producers push with a
+	// compare and swap, the writer takes the whole list at once.
+	std::atomic<Frame *> pending{nullptr};
+	sem_t wakeup;
+	std::atomic<bool> stopping{false};
+	std::atomic<uint64_t> written{0};
+	std::atomic<uint64_t> dropped{0};
+	std::atomic<bool> failed{false};
+	bool persist;
+	std::thread writer;
+
+	// the frame being built by the caller, and the data buffer used the
+	// same way as GnuplotPipe's
+	std::string frame;
+	std::vector<std::string> buffer;
+
+	void writerLoop();
+	void push(Frame *f);
+
+public:
+	AsyncGnuplotPipe(bool persist = true);
+	~AsyncGnuplotPipe();
+
+	void sendLine(const std::string &text, bool useBuffer = false);
+	void sendEndOfData(unsigned repeatBuffer = 1);
+	void sendNewDataBlock();
+
+	/**
+	 * @brief hands the lines sent since the last frame to the writer
+	 * thread, never blocks
+	 * @param replaceable true for a complete plot that a newer frame makes
+	 * stale, false for setup (e.g. datablocks) that later frames need
+	 * @return false if the pipe has failed, the frame is discarded
+	 */
+	bool sendFrame(bool replaceable = true);
+
+	/**
+	 * @brief true once gnuplot couldn't be started or stopped taking
+	 * frames, nothing sent to this pipe will be plotted
+	 */
+	bool hasFailed() const { return failed; }
+
+	uint64_t framesWritten() const { return written; }
+	uint64_t framesDropped() const { return dropped; }
+
+	AsyncGnuplotPipe(AsyncGnuplotPipe const&) = delete;
+	void operator=(AsyncGnuplotPipe const&) = delete;
+};
+
+#endif
@@ -0,0 +1,170 @@
+/**
+ * @file BatchCommands.hpp
+ * @brief Declarations for the headless compton_batch program. Each
+ * subcommand lives in its own file in src/batch and takes the parsed
+ * --key value options.
+ */
+
+#ifndef BATCH_COMMANDS_H
+#define BATCH_COMMANDS_H
+
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+#include <ComptonEvent.hpp>
+#include <ComptonKernel.hpp>
+#include <ResultArchive.hpp>
+#include <SlabTransport.hpp>
+
+// the --key value pairs given after the subcommand name
+struct BatchOptions {
+	std::map<std::string, std::string> values;
+
+	bool has(const std::string &key) const;
+	std::string get(const std::string &key,
+			const std::string &fallback) const;
+	long double getNumber(const std::string &key,
+			      long double fallback) const;
+};
+
+// the grid of a sweep, theta_steps rows for each wavelength
+struct SweepJob {
+	long double theta_min;
+	long double theta_max;
+	std::size_t theta_steps;
+	std::vector<long double> lambdas;
+
+	uint64_t rows() const { return theta_steps * lambdas.size(); }
+};
+
+/**
+ * @brief parses "--key value" pairs, a "--flag" with no value is set to "1"
+ * @throw std::invalid_argument for arguments that don't start with "--"
+ */
+BatchOptions parse_batch_options(int argc, char **argv, int first);
+
+/**
+ * @brief scatters an incident spectrum file, see ComptonSpectrum.hpp
+ */
+int spectrum_command(const BatchOptions &options);
+
+/**
+ * @brief Doppler broadened scattering off a bound electron, see
+ * ComptonProfile.hpp
+ */
+int profile_command(const BatchOptions &options);
+
+/**
+ * @brief Monte Carlo photon transport through a slab, see SlabTransport.hpp
+ */
+int transport_command(const BatchOptions &options);
+
+/**
+ * @brief the results over a range of angles, see ComptonSweep.hpp
+ */
+int sweep_command(const BatchOptions &options);
+
+/**
+ * @brief draws Compton shift plots to image files on a pool of gnuplot
+ * processes, see ShiftPlot.hpp
+ */
+int render_command(const BatchOptions &options);
+
+/**
+ * @brief the query server, see ComptonProtocol.hpp
+ */
+int serve_command(const BatchOptions &options);
+
+/**
+ * @brief load generator for the query server, reports latency percentiles
+ * and throughput
+ */
+int loadgen_command(const BatchOptions &options);
+
+/**
+ * @brief adaptive sweeps over theta, see AdaptiveSweep.hpp
+ */
+int adaptive_command(const BatchOptions &options);
+
+/**
+ * @brief splits a sweep or transport job into shards, see ShardManifest.hpp
+ */
+int shard_plan_command(const BatchOptions &options);
+
+/**
+ * @brief runs one shard, or claims and runs shards until none are left
+ */
+int run_shard_command(const BatchOptions &options);
+
+/**
+ * @brief combines the shard outputs of a job
+ */
+int merge_command(const BatchOptions &options);
+
+/**
+ * @brief decompresses a result archive, see ResultArchive.hpp
+ */
+int unpack_command(const BatchOptions &options);
+
+/**
+ * @brief splits a comma separated list of numbers
+ */
+std::vector<long double> parse_number_list(const std::string &list);
+
+/**
+ * @brief reads --theta-min, --theta-max, --theta-steps and --lambda
+ */
+SweepJob sweep_job_from_options(const BatchOptions &options);
+
+/**
+ * @brief writes the comment line naming the columns of write_result_rows
+ */
+void write_result_header(std::ostream &out);
+
+/**
+ * @brief writes result rows as whitespace separated columns in the order of
+ * ComptonResultValues
+ */
+void write_result_rows(std::ostream &out,
+		       const std::vector<ComptonResultValues> &rows);
+void write_result_rows(std::ostream &out, const ComptonResultValues *rows,
+		       std::size_t n);
+
+/**
+ * @brief reads --precision, --error, --keep-derived, --chunk-rows and
+ * --threads, the settings of a result archive
+ * @throw std::invalid_argument for unknown columns or precisions
+ */
+ArchiveSettings archive_settings_from_options(const BatchOptions &options);
+
+/**
+ * @brief prints the size of a finished archive next to the raw rows
+ */
+void print_archive_size(uint64_t rows, uint64_t bytes);
+
+/**
+ * @brief prints how many rows had errors, and which, see compton_status()
+ */
+void print_error_counts(const ComptonErrorCounts &counts);
+
+/**
+ * @brief reads the --lambda, --thickness, --histories, ... slab settings
+ * @throw std::invalid_argument for non-positive sizes
+ */
+SlabSettings slab_settings_from_options(const BatchOptions &options);
+
+/**
+ * @brief prints the counters of a finished transport run
+ */
+void print_slab_tally(const SlabTally &tally);
+
+/**
+ * @brief writes one exit spectrum of a transport run as (wavelength shift
+ * in pm, count) rows
+ */
+void write_exit_spectrum(const std::vector<uint64_t> &spectrum,
+			 const SlabSettings &settings,
+			 const std::string &path);
+
+#endif
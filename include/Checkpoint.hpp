@@ -0,0 +1,145 @@
+/**
+ * @file Checkpoint.hpp
+ * @brief Checkpoint files for long batch runs, so a run that is stopped
+ * (or whose machine goes away) can carry on from its last checkpoint.
+ *
+ * A checkpoint is a small binary file: a header with a magic number, the
+ * format version, the kind of run, the payload length and a checksum of
+ * the payload, then the payload itself. CheckpointWriter writes them on
+ * its own thread, to a temporary file that is renamed over the old
+ * checkpoint, so the file on disk is always a complete checkpoint. The
+ * outputs of shards (see ShardManifest.hpp) are written in the same format.
+ */
+
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+const uint32_t CHECKPOINT_VERSION = 1;
+
+// what the payload holds, a checkpoint of one kind can't resume another
+const uint32_t CHECKPOINT_TRANSPORT = 1;
+const uint32_t CHECKPOINT_SWEEP = 2;
+const uint32_t CHECKPOINT_SWEEP_SHARD = 3;
+const uint32_t CHECKPOINT_TRANSPORT_SHARD = 4;
+
+/**
+ * @brief 64 bit FNV-1a hash, for the payload checksum and for
+ * fingerprints of run settings
+ */
+uint64_t fnv1a_hash(const void *data, std::size_t length,
+		    uint64_t hash = 0xCBF29CE484222325ULL);
+
+// a long double in the 80 bit x87 extended format, which is how
+// checkpoints and result archives store them whatever the machine's own
+// long double is
+struct ExtendedBits {
+	uint64_t mantissa;        // with the explicit integer bit
+	uint16_t sign_exponent;
+};
+
+/**
+ * @brief converts to the x87 format, exactly unless the machine's long
+ * double has more than 64 mantissa bits
+ */
+ExtendedBits to_extended_bits(long double value);
+
+/**
+ * @brief converts from the x87 format, rounding to the machine's long
+ * double where it has fewer bits
+ */
+long double from_extended_bits(ExtendedBits bits);
+
+/**
+ * @brief the payload of a checkpoint, filled with put*() when saving and
+ * read back in the same order with get*() when resuming. The get
+ * functions throw if the payload is shorter than expected.
+ */
+class CheckpointData {
+private:
+	std::vector<char> bytes;
+	std::size_t position = 0;
+
+public:
+	CheckpointData() = default;
+	CheckpointData(std::vector<char> bytes) : bytes{std::move(bytes)} {}
+
+	void putU64(uint64_t value);
+	void putU64s(const std::vector<uint64_t> &values);
+	void putLongDouble(long double value);
+	uint64_t getU64();
+	std::vector<uint64_t> getU64s();
+	long double getLongDouble();
+
+	const std::vector<char> &getBytes() const { return bytes; }
+};
+
+class CheckpointWriter {
+private:
+	std::string path;
+	std::thread writer;
+	std::mutex lock;
+	std::condition_variable changed;
+
+	// only the newest checkpoint waiting to be written is kept
+	CheckpointData pending;
+	uint32_t pending_kind = 0;
+	bool has_pending = false;
+	bool busy = false;
+	bool stopping = false;
+	std::string error;
+
+	uint64_t written = 0;
+	double write_seconds = 0;
+
+	void writerLoop();
+
+public:
+	/**
+	 * @param path the checkpoint file, replaced by every write
+	 */
+	CheckpointWriter(const std::string &path);
+	~CheckpointWriter();
+
+	/**
+	 * @brief queues a checkpoint and returns without waiting for the disk.
+	 * A checkpoint still waiting from an earlier submit is replaced.
+	 */
+	void submit(uint32_t kind, CheckpointData data);
+
+	/**
+	 * @brief waits until everything submitted is on disk
+	 * @throws std::runtime_error if a write failed
+	 */
+	void wait();
+
+	uint64_t checkpointsWritten();
+	double writeSeconds();
+
+	CheckpointWriter(CheckpointWriter const&) = delete;
+	void operator=(CheckpointWriter const&) = delete;
+};
+
+/**
+ * @brief writes a checkpoint file straight away, on the calling thread
+ * @throws std::runtime_error if the file can't be written
+ */
+void write_checkpoint(const std::string &path, uint32_t kind,
+		      const CheckpointData &data);
+
+/**
+ * @brief reads and checks a checkpoint file
+ * @param path the checkpoint file
+ * @param kind the kind of run expected in it
+ * @throws std::runtime_error if the file is missing, damaged, from another
+ * version or of another kind
+ */
+CheckpointData read_checkpoint(const std::string &path, uint32_t kind);
+
+#endif
@@ -11,7 +11,6 @@
 #ifndef COMPTON_EVENT_H
 #define COMPTON_EVENT_H
 
-#include <iostream>
 #include <cmath>
 
 // container used to return necessary values when graphing compton
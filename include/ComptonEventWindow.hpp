@@ -3,6 +3,10 @@
 
 #include <gtk/gtk.h>
 #include <ComptonEvent.hpp>
+#include <ComptonInformation.hpp>
+#include <ComptonKernel.hpp>
+#include <ComptonProfile.hpp>
+#include <ComptonSweep.hpp>
 #include <graphing.hpp>
 #include <sstream>
 #include <iomanip>
@@ -26,7 +30,20 @@ struct result_labels {
 struct args {
 	GtkWidget *theta_val;
 	GtkWidget *lambda_val;
+	GtkWidget *element_val;
 	struct result_labels *results;
+	// says what is wrong with the inputs or results, empty when nothing
+	GtkWidget *status;
+
+	// the angular distribution for the current lambda (NULL until
+	// prepare_angular_sweep() runs), and the plotter that draws it
+	ComptonSweep *sweep;
+	ScatterPlotter *plotter;
+};
+
+struct view_args {
+	struct args *multi_arg;
+	ScatterView view;
 };
 
 
@@ -65,6 +82,43 @@ void insert_lambda_event(GtkEditable *theta_entry, const gchar *text,
  */
 void submit_clicked(GtkWidget *button, struct args *multi_arg);
 
+/**
+ * @brief draws one of the angular plots from the already calculated sweep
+ * @param button the view's button
+ * @param view the window's args and which view to draw
+ */
+void view_clicked(GtkWidget *button, struct view_args *view);
+
+/**
+ * @brief reads a number typed into an entry
+ * @param text the entry's text
+ * @param value set to the number
+ * @return false unless the whole text is one number
+ */
+bool parse_entry_number(const gchar *text, long double &value);
+
+/**
+ * @brief what the status bits of a calculation mean, "" for none
+ * @param status COMPTON_* status bits, see compton_status()
+ */
+std::string status_message(uint32_t status);
+
+/**
+ * @brief calculates the angular sweep for the default lambda if it hasn't
+ * been already, run as an idle callback once the window is up
+ * @param multi_arg the args holding the sweep and plotter
+ * @return G_SOURCE_REMOVE
+ */
+gboolean prepare_angular_sweep(struct args *multi_arg);
+
+/**
+ * @brief recalculates the angular sweep when lambda has changed and hands
+ * the new buffers to the plotter
+ * @param multi_arg the sweep and plotter
+ * @param lambda the incident wavelength in picometers
+ */
+void update_angular_sweep(struct args *multi_arg, long double lambda);
+
 /**
  * @brief creates all of the result labels for the calculation results
  * @param outer_box the outer GTK box containing all of the boxes
@@ -82,10 +136,28 @@ void create_result_labels(GtkWidget *outer_box,
  */
 void set_result_labels(struct result_labels *results, ComptonEvent event);
 
+/**
+ * @brief updates the result labels from already calculated values, used
+ * for the bound electron results which don't come from a ComptonEvent
+ * @param results all of the result label widgets in a struct
+ * @param eventResult the values to show
+ */
+void set_result_labels(struct result_labels *results,
+		       ComptonResultValues eventResult);
+
+/**
+ * @brief loads the Compton profile for an element the first time it is
+ * used and keeps it for later submits
+ * @param element the element symbol typed by the user
+ */
+const ComptonProfile &cached_compton_profile(const std::string &element);
+
 /** 
  * @brief creates the window that allows user input to generate calculations
+ * @param app the application the window belongs to
+ * @return the window, not shown yet
  */
-void create_calculation_window();
+GtkWidget *create_calculation_window(GtkApplication *app);
 
 
 #endif
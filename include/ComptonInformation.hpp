@@ -1,6 +1,19 @@
+#ifndef COMPTON_INFORMATION_H
+#define COMPTON_INFORMATION_H
+
 #include <gtk/gtk.h>
 
-void create_information_window();
+// the image compiled into the program from
+// src/user_interface/compton.gresource.xml
+#define COMPTON_IMAGE_RESOURCE \
+	"/org/compton/simulator/compton-scattering-final-border.png"
+
+/**
+ * @brief shows the informational window, building it the first time
+ * @param parent the calculation window, kept behind the information
+ */
+void show_information_window(GtkWindow *parent);
 
 void close_button_clicked(GtkWidget *close_button, gpointer data);
 
+#endif
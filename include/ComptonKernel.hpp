@@ -0,0 +1,273 @@
+/**
+ * @file ComptonKernel.hpp
+ * @brief Inline versions of the ComptonEvent formulas for the bulk
+ * calculations. Unlike ComptonEvent these do not print anything and do not
+ * build an object per collision, so they can be called millions of times.
+ */
+
+#ifndef COMPTON_KERNEL_H
+#define COMPTON_KERNEL_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <ComptonEvent.hpp>
+#include <globals.hpp>
+
+// Compton wavelength of the electron, h / (m_0 * c), in meters
+const long double COMPTON_WAVELENGTH =
+	PLANCK_CONSTANT / (M_NAUGHT * SPEED_OF_LIGHT);
+
+/**
+ * @brief post-collision wavelength (meters), same as
+ * ComptonEvent::setLambdaPrime()
+ * @param lambda_naught the incident wavelength in meters
+ * @param cos_theta cosine of the photon scatter angle
+ */
+inline long double compton_lambda_prime(long double lambda_naught,
+					long double cos_theta)
+{
+	return lambda_naught + COMPTON_WAVELENGTH * (1 - cos_theta);
+}
+
+/**
+ * @brief photon energy (joules), E = hc / lambda
+ */
+inline long double photon_energy(long double lambda)
+{
+	return PLANCK_CONSTANT * SPEED_OF_LIGHT / lambda;
+}
+
+/**
+ * @brief photon momentum (kg * m/s), p = h / lambda
+ */
+inline long double photon_momentum(long double lambda)
+{
+	return PLANCK_CONSTANT / lambda;
+}
+
+/**
+ * @brief recoil electron kinetic energy (joules) for a photon going from
+ * lambda_naught to lambda_prime
+ */
+inline long double electron_energy(long double lambda_naught,
+				   long double lambda_prime)
+{
+	return photon_energy(lambda_naught) - photon_energy(lambda_prime);
+}
+
+/**
+ * @brief Klein-Nishina differential cross-section (m^2 / steradian)
+ * @param lambda_naught the incident wavelength in meters
+ * @param lambda_prime the scattered wavelength in meters
+ * @param sin_theta sine of the photon scatter angle
+ */
+inline long double klein_nishina(long double lambda_naught,
+				 long double lambda_prime,
+				 long double sin_theta)
+{
+	long double ratio = lambda_naught / lambda_prime;
+	return ELECTRON_RADIUS * ELECTRON_RADIUS / 2 * ratio * ratio *
+		(ratio + 1 / ratio - sin_theta * sin_theta);
+}
+
+/**
+ * @brief fills in the results for a collision where the scattered wavelength
+ * is already known (e.g. broadened by a bound electron)
+ * @param theta the photon scatter angle in degrees
+ * @param lambda_naught the incident wavelength in meters
+ * @param lambda_prime the scattered wavelength in meters
+ */
+inline ComptonResultValues compton_results_from_wavelengths(
+	long double theta, long double lambda_naught, long double lambda_prime)
+{
+	long double sin_theta = sin(theta / (180 / M_PI));
+	ComptonResultValues r;
+
+	r.theta = theta;
+	r.lambda_naught = lambda_naught;
+	r.lambda_prime = lambda_prime;
+	r.photon_energy_naught = photon_energy(r.lambda_naught);
+	r.photon_energy_prime = photon_energy(r.lambda_prime);
+	r.photon_momentum_naught = photon_momentum(r.lambda_naught);
+	r.photon_momentum_prime = photon_momentum(r.lambda_prime);
+	r.electron_energy = r.photon_energy_naught - r.photon_energy_prime;
+	r.electron_velocity = sqrt(2 * r.electron_energy / M_NAUGHT);
+	r.electron_momentum = M_NAUGHT * r.electron_velocity;
+	r.electron_scatter_angle =
+		asin(r.photon_momentum_prime * sin_theta
+		     / r.electron_momentum) * 180 / M_PI;
+	return r;
+}
+
+/**
+ * @brief fills in every value that a ComptonEvent would calculate
+ * @param theta the photon scatter angle in degrees
+ * @param lambda_naught the incident wavelength in picometers
+ * @return the same values as ComptonEvent{theta, lambda_naught}.getResults()
+ */
+inline ComptonResultValues compton_evaluate(long double theta,
+					    long double lambda_naught)
+{
+	long double lambda = lambda_naught * pow(10, -12);
+	return compton_results_from_wavelengths(theta, lambda,
+		compton_lambda_prime(lambda, cos(theta / (180 / M_PI))));
+}
+
+/**
+ * @brief evaluates n collisions at once
+ * @param theta scatter angles in degrees
+ * @param lambda_naught incident wavelengths in picometers
+ * @param out caller-owned array of n results
+ */
+inline void compton_evaluate_batch(const long double *theta,
+				   const long double *lambda_naught,
+				   ComptonResultValues *out, std::size_t n)
+{
+	for (std::size_t i = 0; i < n; ++i)
+		out[i] = compton_evaluate(theta[i], lambda_naught[i]);
+}
+
+// status bits of a row, 0 when the inputs are valid and every result is a
+// finite number
+const uint32_t COMPTON_BAD_THETA = 1;         // theta is NaN or infinite
+const uint32_t COMPTON_BAD_LAMBDA = 2;        // lambda is not a positive number
+const uint32_t COMPTON_NONFINITE_RESULT = 4;  // a result is NaN or infinite
+const uint32_t COMPTON_ASIN_DOMAIN = 8;       // the electron angle's asin got
+					      // an argument past +-1
+const int COMPTON_STATUS_BITS = 4;
+
+/**
+ * @brief what a status bit means, for messages
+ * @param bit 0 to COMPTON_STATUS_BITS - 1
+ */
+inline const char *compton_status_name(int bit)
+{
+	switch (bit) {
+	case 0: return "theta is not a number";
+	case 1: return "lambda is not a positive number";
+	case 2: return "a result is not a finite number";
+	case 3: return "the electron angle is outside the domain of asin";
+	}
+	return "unknown status";
+}
+
+/**
+ * @brief 1 for infinities and NaNs
+ */
+inline uint32_t compton_nonfinite(long double x)
+{
+	return (uint32_t) !std::isfinite(x);
+}
+
+/**
+ * @brief 1 for numbers above zero, including infinity
+ */
+inline uint32_t compton_positive(long double x)
+{
+	return (uint32_t) (x > 0);
+}
+
+/**
+ * @brief checks a row's inputs and results. It has no branches: each test
+ * is turned into a 0 or 1 and combined with | and &, which keeps it cheap
+ * next to the arithmetic of the row itself.
+ * @param theta the photon scatter angle in degrees
+ * @param lambda_naught the incident wavelength in picometers
+ * @param r the results calculated from them
+ * @return the COMPTON_* status bits
+ */
+inline uint32_t compton_status(const long double &theta,
+			       const long double &lambda_naught,
+			       const ComptonResultValues &r)
+{
+	uint32_t nonfinite = compton_nonfinite(r.lambda_prime) |
+		compton_nonfinite(r.photon_energy_naught) |
+		compton_nonfinite(r.photon_energy_prime) |
+		compton_nonfinite(r.photon_momentum_naught) |
+		compton_nonfinite(r.photon_momentum_prime) |
+		compton_nonfinite(r.electron_energy) |
+		compton_nonfinite(r.electron_velocity) |
+		compton_nonfinite(r.electron_momentum) |
+		compton_nonfinite(r.electron_scatter_angle);
+	uint32_t bad_lambda = compton_nonfinite(lambda_naught) |
+		(compton_positive(lambda_naught) ^ 1);
+
+	// phi is NaN although its momenta are fine: rounding pushed
+	// p' sin(theta) / p_e past 1 (a zero p_e, at theta = 0, is only
+	// non-finite)
+	uint32_t asin_domain = compton_nonfinite(r.electron_scatter_angle) &
+		(compton_nonfinite(r.electron_momentum) ^ 1) &
+		compton_positive(r.electron_momentum);
+
+	return compton_nonfinite(theta) * COMPTON_BAD_THETA |
+		bad_lambda * COMPTON_BAD_LAMBDA |
+		nonfinite * COMPTON_NONFINITE_RESULT |
+		asin_domain * COMPTON_ASIN_DOMAIN;
+}
+
+// how many rows of a batch had each status bit set
+struct ComptonErrorCounts {
+	uint64_t rows = 0;                           // rows with any bit set
+	uint64_t bits[COMPTON_STATUS_BITS] = {0};
+
+	/**
+	 * @brief adds the rows counted by status word, see
+	 * compton_evaluate_batch_checked()
+	 */
+	void addHistogram(const uint64_t *by_status)
+	{
+		for (uint32_t status = 1; status < 1u << COMPTON_STATUS_BITS;
+		     ++status) {
+			rows += by_status[status];
+			for (int b = 0; b < COMPTON_STATUS_BITS; ++b)
+				bits[b] += ((status >> b) & 1) * by_status[status];
+		}
+	}
+
+	void merge(const ComptonErrorCounts &other)
+	{
+		rows += other.rows;
+		for (int b = 0; b < COMPTON_STATUS_BITS; ++b)
+			bits[b] += other.bits[b];
+	}
+};
+
+// rows evaluated before they are checked: reading a result straight
+// after the x87 store that wrote it stalls, while a block this size is
+// still in the L1 cache when the checks reach it
+const std::size_t COMPTON_CHECK_BLOCK = 64;
+
+/**
+ * @brief evaluates n collisions at once and checks every row as it goes,
+ * a block at a time, see compton_status()
+ * @param theta scatter angles in degrees
+ * @param lambda_naught incident wavelengths in picometers
+ * @param out caller-owned array of n results
+ * @param status caller-owned array of n status words
+ * @return the number of rows with each status bit
+ */
+inline ComptonErrorCounts compton_evaluate_batch_checked(
+	const long double *theta, const long double *lambda_naught,
+	ComptonResultValues *out, uint32_t *status, std::size_t n)
+{
+	// rows are counted by their whole status word, one increment a row,
+	// and split into bits at the end
+	uint64_t by_status[1 << COMPTON_STATUS_BITS] = {0};
+	for (std::size_t first = 0; first < n; first += COMPTON_CHECK_BLOCK) {
+		std::size_t last = std::min(n, first + COMPTON_CHECK_BLOCK);
+		for (std::size_t i = first; i < last; ++i)
+			out[i] = compton_evaluate(theta[i], lambda_naught[i]);
+		for (std::size_t i = first; i < last; ++i) {
+			status[i] = compton_status(theta[i], lambda_naught[i],
+						   out[i]);
+			by_status[status[i]]++;
+		}
+	}
+	ComptonErrorCounts counts;
+	counts.addHistogram(by_status);
+	return counts;
+}
+
+#endif
@@ -0,0 +1,125 @@
+/**
+ * @file ComptonLibrary.hpp
+ * @brief A thin C++ wrapper over compton.h for programs linking libcompton.
+ * It only needs compton.h, not the rest of include/, and unlike the C
+ * functions the vector versions resize their outputs and throw on bad
+ * arguments.
+ */
+
+#ifndef COMPTON_LIBRARY_H
+#define COMPTON_LIBRARY_H
+
+#include <compton.h>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace compton {
+
+using Result = compton_result;
+using ErrorCounts = compton_error_counts;
+
+/**
+ * @brief throws if the library a program runs with is not the version of
+ * the header it was built with
+ */
+inline void check_version()
+{
+	if (compton_abi_version() != COMPTON_ABI_VERSION)
+		throw std::runtime_error("libcompton is ABI version "
+			+ std::to_string(compton_abi_version()) + ", expected "
+			+ std::to_string(COMPTON_ABI_VERSION));
+}
+
+/**
+ * @brief the meanings of every bit set in a status word, comma separated
+ */
+inline std::string status_message(uint32_t status)
+{
+	std::string message;
+	for (int b = 0; b < COMPTON_STATUS_NBITS; ++b)
+		if (status & (1u << b))
+			message += (message.empty() ? "" : ", ")
+				+ std::string(compton_status_text(b));
+	return message;
+}
+
+/**
+ * @brief evaluates one collision
+ * @param theta the photon scatter angle in degrees
+ * @param lambda_naught the incident wavelength in picometers
+ * @param status set to the row's status bits, or nullptr
+ */
+inline Result evaluate(double theta, double lambda_naught,
+		       uint32_t *status = nullptr)
+{
+	Result r;
+	compton_batch_evaluate(&theta, &lambda_naught, &r, status, 1, nullptr);
+	return r;
+}
+
+/**
+ * @brief evaluates a collision for every pair of theta and lambda_naught
+ * @param out resized to the number of rows
+ * @param status resized and filled in, or nullptr
+ * @return the number of rows with a status other than 0
+ * @throws std::invalid_argument if theta and lambda_naught differ in size
+ */
+inline std::size_t evaluate(const std::vector<double> &theta,
+			    const std::vector<double> &lambda_naught,
+			    std::vector<Result> &out,
+			    std::vector<uint32_t> *status = nullptr,
+			    ErrorCounts *counts = nullptr)
+{
+	if (theta.size() != lambda_naught.size())
+		throw std::invalid_argument("theta and lambda_naught must be "
+					    "the same size");
+	out.resize(theta.size());
+	if (status)
+		status->resize(theta.size());
+	return compton_batch_evaluate(theta.data(), lambda_naught.data(),
+				      out.data(),
+				      status ? status->data() : nullptr,
+				      theta.size(), counts);
+}
+
+/**
+ * @brief the scattered wavelengths (meters) of every pair of theta and
+ * lambda_naught
+ * @return the number of rows with invalid inputs or results
+ * @throws std::invalid_argument if theta and lambda_naught differ in size
+ */
+inline std::size_t lambda_prime(const std::vector<double> &theta,
+				const std::vector<double> &lambda_naught,
+				std::vector<double> &out)
+{
+	if (theta.size() != lambda_naught.size())
+		throw std::invalid_argument("theta and lambda_naught must be "
+					    "the same size");
+	out.resize(theta.size());
+	return compton_batch_lambda_prime(theta.data(), lambda_naught.data(),
+					  out.data(), theta.size());
+}
+
+/**
+ * @brief the Klein-Nishina cross-sections (m^2 / steradian) of every pair
+ * of theta and lambda_naught
+ * @return the number of rows with invalid inputs or results
+ * @throws std::invalid_argument if theta and lambda_naught differ in size
+ */
+inline std::size_t klein_nishina(const std::vector<double> &theta,
+				 const std::vector<double> &lambda_naught,
+				 std::vector<double> &out)
+{
+	if (theta.size() != lambda_naught.size())
+		throw std::invalid_argument("theta and lambda_naught must be "
+					    "the same size");
+	out.resize(theta.size());
+	return compton_batch_klein_nishina(theta.data(), lambda_naught.data(),
+					   out.data(), theta.size());
+}
+
+}
+
+#endif
@@ -0,0 +1,92 @@
+/**
+ * @file ComptonProfile.hpp
+ * @brief Declarations for the bound electron (Doppler broadened) mode.
+ *
+ * ComptonEvent assumes the electron is free and at rest. A bound electron
+ * is moving, so the scattered wavelength is spread around the free electron
+ * value according to the element's Compton profile J(p_z), where p_z is the
+ * electron momentum along the scattering vector (atomic units).
+ */
+
+#ifndef COMPTON_PROFILE_H
+#define COMPTON_PROFILE_H
+
+#include <ComptonEvent.hpp>
+#include <ComptonSpectrum.hpp>
+#include <string>
+#include <vector>
+
+// fine structure constant, one atomic unit of momentum is m_0 * c * alpha
+const long double FINE_STRUCTURE = 7.2973525693E-3;
+
+class ComptonProfile {
+private:
+	std::string element;
+
+	// inverse of the cumulative distribution of p_z, sampled at
+	// table_size evenly spaced probabilities so a lookup is O(1)
+	std::vector<long double> inverse_cdf;
+
+public:
+	/**
+	 * @brief builds the sampling table from a tabulated profile
+	 * @param element the element symbol, only used for labels
+	 * @param p_z momenta (atomic units) >= 0, increasing
+	 * @param j the profile J(p_z) at each momentum, the profile is
+	 * symmetric so only p_z >= 0 is given
+	 * @param table_size number of entries in the inverse CDF table
+	 */
+	ComptonProfile(const std::string &element,
+		       const std::vector<long double> &p_z,
+		       const std::vector<long double> &j,
+		       std::size_t table_size = 4096);
+
+	const std::string &getElement() const { return element; }
+
+	/**
+	 * @brief maps a uniform random number in [0, 1] to a p_z with the
+	 * distribution of the profile, in constant time
+	 */
+	long double samplePz(long double u) const;
+
+	/**
+	 * @brief the broadened distribution of the scattered wavelength (meters)
+	 * @param theta the photon scatter angle in degrees
+	 * @param lambda_naught the incident wavelength in picometers
+	 * @param bins number of bins in the returned spectrum
+	 */
+	BinnedSpectrum broadenedSpectrum(long double theta,
+					 long double lambda_naught,
+					 std::size_t bins) const;
+};
+
+/**
+ * @brief reads <directory>/<element>.txt, two columns p_z (atomic units) and
+ * J(p_z), lines starting with '#' are ignored
+ * @throw std::runtime_error if the file can't be read or has no rows
+ */
+ComptonProfile load_compton_profile(const std::string &element,
+				    const std::string &directory =
+				    "data/compton_profiles");
+
+/**
+ * @brief scattered wavelength (meters) off an electron with momentum p_z
+ * @param lambda_naught the incident wavelength in meters
+ * @param cos_theta cosine of the photon scatter angle
+ * @param p_z electron momentum along the scattering vector (atomic units),
+ * 0 gives the free electron result
+ */
+long double doppler_lambda_prime(long double lambda_naught,
+				 long double cos_theta, long double p_z);
+
+/**
+ * @brief the same values as compton_evaluate(), but with the scattered
+ * wavelength drawn from the profile
+ * @param u uniform random number in [0, 1], 0.5 gives the median
+ */
+ComptonResultValues compton_evaluate_bound(long double theta,
+					   long double lambda_naught,
+					   const ComptonProfile &profile,
+					   long double u);
+
+#endif
@@ -0,0 +1,59 @@
+/**
+ * @file ComptonProtocol.hpp
+ * @brief The binary protocol of the query server ("compton_batch serve").
+ *
+ * Clients connect to a Unix domain socket and write fixed size requests,
+ * as many as they like without waiting for the answers. Every request gets
+ * one response with the same id, in the order the requests were sent on
+ * that connection. Both ends are on the same machine, so the structs are
+ * sent as they are in memory (native byte order).
+ */
+
+#ifndef COMPTON_PROTOCOL_H
+#define COMPTON_PROTOCOL_H
+
+#include <ComptonEvent.hpp>
+#include <cstdint>
+
+struct ComptonRequest {
+	uint32_t id;           // chosen by the client, echoed in the response
+	uint32_t reserved;
+	double theta;          // degrees
+	double lambda_naught;  // picometers
+};
+
+// the values of ComptonResultValues, in the same order
+const int COMPTON_RESPONSE_VALUES = 11;
+
+struct ComptonResponse {
+	uint32_t id;
+	uint32_t status;       // COMPTON_* bits of ComptonKernel.hpp, 0 when
+			       // the request and every value are valid
+	double values[COMPTON_RESPONSE_VALUES];
+};
+
+static_assert(sizeof(ComptonRequest) == 24, "request must be 24 bytes");
+static_assert(sizeof(ComptonResponse) == 96, "response must be 96 bytes");
+
+/**
+ * @brief fills a response from the calculated results
+ */
+inline void encode_response(ComptonResponse &response, uint32_t id,
+			    uint32_t status, const ComptonResultValues &r)
+{
+	response.id = id;
+	response.status = status;
+	response.values[0] = r.theta;
+	response.values[1] = r.lambda_naught;
+	response.values[2] = r.lambda_prime;
+	response.values[3] = r.photon_energy_naught;
+	response.values[4] = r.photon_energy_prime;
+	response.values[5] = r.photon_momentum_naught;
+	response.values[6] = r.photon_momentum_prime;
+	response.values[7] = r.electron_energy;
+	response.values[8] = r.electron_velocity;
+	response.values[9] = r.electron_momentum;
+	response.values[10] = r.electron_scatter_angle;
+}
+
+#endif
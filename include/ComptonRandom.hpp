@@ -0,0 +1,81 @@
+/**
+ * @file ComptonRandom.hpp
+ * @brief Small random number generator for the Monte Carlo code
+ * (xoshiro256**, seeded with splitmix64).
+ *
+ * Every batch of photon histories gets its own stream, derived only from
+ * the run seed and the batch number, so the results don't depend on how
+ * many threads run the batches or in which order. The whole state is four
+ * integers, which keeps it easy to save and restore.
+ */
+
+#ifndef COMPTON_RANDOM_H
+#define COMPTON_RANDOM_H
+
+#include <cstdint>
+
+class ComptonRandom {
+private:
+	uint64_t s[4];
+
+	static uint64_t rotl(uint64_t x, int k)
+	{
+		return (x << k) | (x >> (64 - k));
+	}
+
+public:
+	/**
+	 * @brief splitmix64, used to spread a seed over the whole state
+	 */
+	static uint64_t splitmix64(uint64_t &x)
+	{
+		uint64_t z = (x += 0x9E3779B97F4A7C15ULL);
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+		return z ^ (z >> 31);
+	}
+
+	/**
+	 * @brief the generator for one stream of a run
+	 * @param seed the seed of the whole run
+	 * @param stream the stream number, e.g. the batch index
+	 */
+	ComptonRandom(uint64_t seed, uint64_t stream = 0)
+	{
+		uint64_t x = seed ^ splitmix64(stream);
+		for (uint64_t &word : s)
+			word = splitmix64(x);
+	}
+
+	uint64_t next()
+	{
+		uint64_t result = rotl(s[1] * 5, 7) * 9;
+		uint64_t t = s[1] << 17;
+
+		s[2] ^= s[0];
+		s[3] ^= s[1];
+		s[1] ^= s[2];
+		s[0] ^= s[3];
+		s[2] ^= t;
+		s[3] = rotl(s[3], 45);
+		return result;
+	}
+
+	/**
+	 * @brief uniform double in [0, 1) with 53 random bits
+	 */
+	double uniform()
+	{
+		return (next() >> 11) * 0x1.0p-53;
+	}
+
+	/**
+	 * @brief uniform double in (0, 1], safe to take the log of
+	 */
+	double uniformPositive()
+	{
+		return ((next() >> 11) + 1) * 0x1.0p-53;
+	}
+};
+
+#endif
@@ -0,0 +1,82 @@
+/**
+ * @file ComptonSpectrum.hpp
+ * @brief Declarations for scattering a whole incident spectrum (line plus
+ * continuum sources such as X-ray tubes) instead of a single wavelength.
+ *
+ * Everything works on binned spectra, so the cost depends on the number of
+ * bins and never on a number of simulated photons.
+ */
+
+#ifndef COMPTON_SPECTRUM_H
+#define COMPTON_SPECTRUM_H
+
+#include <string>
+#include <vector>
+
+// one row of a spectrum file: wavelength (picometers) and its intensity
+struct SpectrumPoint {
+	long double lambda;
+	long double intensity;
+};
+
+// a spectrum on a uniform grid, used for wavelengths (meters) and for
+// electron energies (joules)
+struct BinnedSpectrum {
+	long double start;     // lower edge of the first bin
+	long double bin_width;
+	std::vector<long double> counts;
+
+	long double binCenter(std::size_t i) const
+	{
+		return start + (i + 0.5L) * bin_width;
+	}
+	long double total() const;
+	void deposit(long double x, long double value);
+};
+
+// the photon and recoil electron spectra after scattering
+struct ScatteredSpectrum {
+	BinnedSpectrum photon;   // wavelength in meters
+	BinnedSpectrum electron; // kinetic energy in joules
+};
+
+/**
+ * @brief reads a two column (picometers, intensity) spectrum file, lines
+ * starting with '#' are ignored
+ * @throw std::runtime_error if the file can't be read or has no rows
+ */
+std::vector<SpectrumPoint> load_spectrum(const std::string &path);
+
+/**
+ * @brief puts the spectrum rows on a uniform wavelength grid (meters),
+ * splitting each row between its two nearest bins so lines are not lost
+ * @param points the rows from load_spectrum()
+ * @param bins number of bins, the grid spans the smallest to largest row
+ */
+BinnedSpectrum bin_spectrum(const std::vector<SpectrumPoint> &points,
+			    std::size_t bins);
+
+/**
+ * @brief scattered spectra for photons that all scatter at one angle
+ * @param incident the binned incident spectrum
+ * @param theta the photon scatter angle in degrees
+ */
+ScatteredSpectrum scatter_spectrum(const BinnedSpectrum &incident,
+				   long double theta);
+
+/**
+ * @brief scattered spectra over all angles, each angle weighted by the
+ * Klein-Nishina cross-section of every incident bin. The result is
+ * normalized so that the scattered intensity equals the incident intensity.
+ * @param incident the binned incident spectrum
+ * @param theta_steps number of angles between 0 and 180 degrees
+ */
+ScatteredSpectrum scatter_spectrum_all_angles(const BinnedSpectrum &incident,
+					      std::size_t theta_steps);
+
+/**
+ * @brief writes a binned spectrum as two columns (bin center, counts)
+ */
+void write_spectrum(const BinnedSpectrum &spectrum, const std::string &path);
+
+#endif
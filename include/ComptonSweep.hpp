@@ -0,0 +1,105 @@
+/**
+ * @file ComptonSweep.hpp
+ * @brief Declaration for the ComptonSweep class, the results of a collision
+ * for a whole range of scatter angles at one incident wavelength.
+ *
+ * The parts of the calculation that only depend on theta (its sine and the
+ * Compton shift from its cosine) and the parts that only depend on lambda
+ * (the incident photon's energy and momentum) are kept, so changing lambda
+ * doesn't recalculate any trigonometry and changing one angle only
+ * recalculates that angle's row.
+ */
+
+#ifndef COMPTON_SWEEP_H
+#define COMPTON_SWEEP_H
+
+#include <ComptonEvent.hpp>
+#include <ComptonKernel.hpp>
+#include <vector>
+
+class ComptonSweep {
+private:
+	// theta only: the angle (degrees), sin(theta) and the wavelength
+	// shift h / (m_0 c) * (1 - cos(theta)) in meters
+	std::vector<long double> theta;
+	std::vector<long double> sin_theta;
+	std::vector<long double> shift;
+
+	// lambda only, in picometers (as given), meters, joules and kg * m/s
+	long double lambda_picometers;
+	long double lambda_naught;
+	long double energy_naught;
+	long double momentum_naught;
+
+	std::vector<ComptonResultValues> results;
+	// the compton_status() bits of every row
+	std::vector<uint32_t> status;
+
+	void setAngleTerms(std::size_t i, long double theta);
+	void updateRow(std::size_t i);
+	void updateRows();
+
+public:
+	/**
+	 * @brief sweeps steps angles evenly from theta_min to theta_max
+	 * @param theta_min the first angle in degrees
+	 * @param theta_max the last angle in degrees
+	 * @param steps number of angles (at least 2)
+	 * @param lambda_naught the incident wavelength in picometers
+	 */
+	ComptonSweep(long double theta_min, long double theta_max,
+		     std::size_t steps, long double lambda_naught);
+
+	/**
+	 * @brief changes the incident wavelength, only the lambda dependent
+	 * parts of every row are recalculated
+	 * @param lambda_naught the incident wavelength in picometers
+	 */
+	void setLambda(long double lambda_naught);
+
+	/**
+	 * @brief changes a single angle, only that row is recalculated
+	 * @param i the row
+	 * @param theta the new angle in degrees
+	 */
+	void setTheta(std::size_t i, long double theta);
+
+	/**
+	 * @brief replaces every angle, keeping the incident wavelength terms
+	 */
+	void setThetaRange(long double theta_min, long double theta_max,
+			   std::size_t steps);
+
+	/**
+	 * @brief angle i (degrees) of steps angles evenly from theta_min to
+	 * theta_max, the angles setThetaRange() uses
+	 */
+	static long double angle(long double theta_min, long double theta_max,
+				 std::size_t steps, std::size_t i)
+	{
+		return theta_min + (theta_max - theta_min) * i / (steps - 1);
+	}
+
+	long double getLambda() const;
+	std::size_t size() const { return results.size(); }
+	const ComptonResultValues &operator[](std::size_t i) const
+	{
+		return results[i];
+	}
+	const std::vector<ComptonResultValues> &getResults() const
+	{
+		return results;
+	}
+
+	/**
+	 * @brief the COMPTON_* status bits of every row, 0 for a valid row
+	 */
+	const std::vector<uint32_t> &getStatus() const { return status; }
+
+	/**
+	 * @brief how many rows have each status bit set
+	 */
+	ComptonErrorCounts errorCounts() const;
+};
+
+#endif
@@ -0,0 +1,53 @@
+/**
+ * @file PlotBuffers.hpp
+ * @brief Declarations for the sample buffers behind the angular (polar and
+ * 3-D) plots. The buffers are filled in one pass over a ComptonSweep and
+ * can be thinned out for display without touching the physics again.
+ */
+
+#ifndef PLOT_BUFFERS_H
+#define PLOT_BUFFERS_H
+
+#include <ComptonSweep.hpp>
+#include <vector>
+
+struct ScatterPlotBuffers {
+	// one entry per (finite) row of the sweep
+	std::vector<float> theta;          // photon scatter angle (radians)
+	std::vector<float> lambda_prime;   // scattered wavelength (pm)
+	std::vector<float> electron_phi;   // electron scatter angle (degrees)
+	std::vector<float> intensity;      // Klein-Nishina, 1 = forward
+
+	// the scattered photon and recoil electron directions in the
+	// scattering plane, as the distance from (radial) and along (axial)
+	// the incident direction. The photon's length is its intensity, the
+	// electron's its share of the incident photon's energy. Both are
+	// symmetric around the incident axis, so the 3-D view sweeps them
+	// around it when drawing.
+	std::vector<float> photon_radial;
+	std::vector<float> photon_axial;
+	std::vector<float> electron_radial;
+	std::vector<float> electron_axial;
+};
+
+/**
+ * @brief fills the plot buffers from every row of a sweep. Rows where the
+ * results aren't finite (e.g. phi at theta = 0) are left out.
+ * @param sweep the calculated sweep
+ */
+ScatterPlotBuffers make_scatter_plot_buffers(const ComptonSweep &sweep);
+
+/**
+ * @brief level of detail: picks at most about max_points rows to draw. The
+ * rows are split into buckets and each bucket keeps its first row and the
+ * rows with the smallest and largest value of every series, so peaks and
+ * sharp edges survive the thinning.
+ * @param series the columns to preserve extremes of, all the same length
+ * @param max_points roughly how many rows to keep
+ * @return increasing row indices
+ */
+std::vector<std::size_t> downsample_indices(
+	const std::vector<const std::vector<float> *> &series,
+	std::size_t max_points);
+
+#endif
@@ -0,0 +1,152 @@
+/**
+ * @file ResultArchive.hpp
+ * @brief Compressed column files for very large sets of result rows, much
+ * smaller than the raw ComptonResultValues (176 bytes a row) or the text
+ * that compton_batch sweep writes.
+ *
+ * Rows are stored in chunks of chunk_rows rows, each chunk holding one
+ * compressed stream per column, and an index at the end of the file gives
+ * where every chunk starts, so the chunks can be decompressed in parallel.
+ *
+ * Each column can be:
+ * - kept as long double, or reduced to double or float;
+ * - given a relative error bound, in which case the mantissa bits that
+ *   the bound doesn't need are cleared before compression;
+ * - left out of a chunk when it can be rebuilt from the columns before it
+ *   with the ComptonKernel formulas (momenta and energies from the
+ *   wavelengths, and so on). The writer only leaves a column out when the
+ *   rebuilt values are the same as the stored ones would have been (or
+ *   within the error bound, or four units in the last place of a reduced
+ *   precision, of the column's largest value in the chunk), otherwise the
+ *   chunk stores it. Rebuilding uses the libm of the reader, which on
+ *   another system may differ in the last bit.
+ *
+ * Theta and lambda_naught keep two more bits than their error bound needs,
+ * and a chunk where they are reduced is also tried with them whole, which
+ * lets every other column be rebuilt exactly, keeping the smaller; so a
+ * chunk is never bigger than it would be lossless.
+ *
+ * A stored column is compressed like Gorilla: each value is XORed with the
+ * one before it, and only the bits that differ are written, reusing the
+ * position of the previous difference when it fits. The long double sign
+ * and exponent word is stored as one bit while it doesn't change.
+ */
+
+#ifndef RESULT_ARCHIVE_H
+#define RESULT_ARCHIVE_H
+
+#include <ComptonEvent.hpp>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+const uint32_t RESULT_ARCHIVE_VERSION = 1;
+
+// the columns of ComptonResultValues, in order
+const std::size_t RESULT_COLUMNS = 11;
+extern const char *const RESULT_COLUMN_NAMES[RESULT_COLUMNS];
+
+enum class ColumnPrecision : uint8_t {
+	LONG_DOUBLE,
+	DOUBLE,
+	FLOAT
+};
+
+struct ArchiveColumn {
+	ColumnPrecision precision = ColumnPrecision::LONG_DOUBLE;
+	// largest relative error, 0 keeps every bit of the precision
+	long double error = 0;
+	// leave the column out of chunks where it can be rebuilt
+	bool derive = true;
+};
+
+struct ArchiveSettings {
+	ArchiveColumn columns[RESULT_COLUMNS];
+	std::size_t chunk_rows = 65536;
+	// threads compressing or decompressing chunks, 0 for one per core
+	unsigned threads = 0;
+};
+
+/**
+ * @brief the index of a column from its name in RESULT_COLUMN_NAMES
+ * @throws std::invalid_argument for unknown names
+ */
+std::size_t result_column_index(const std::string &name);
+
+class ResultArchiveWriter {
+private:
+	std::ofstream out;
+	std::string path;
+	ArchiveSettings settings;
+	std::vector<ComptonResultValues> pending;
+	std::vector<uint64_t> offsets;
+	uint64_t rows = 0;
+	uint64_t position = 0;
+
+	void writeBytes(const void *data, std::size_t length);
+	void flushChunks(bool all);
+
+public:
+	/**
+	 * @brief creates the file and writes its header
+	 * @throws std::runtime_error if it can't be written
+	 */
+	ResultArchiveWriter(const std::string &path,
+			    const ArchiveSettings &settings);
+
+	/**
+	 * @brief adds rows, compressing every full chunk
+	 */
+	void write(const ComptonResultValues *values, std::size_t n);
+	void write(const std::vector<ComptonResultValues> &values);
+
+	/**
+	 * @brief compresses the last chunk and writes the index, the file is
+	 * incomplete until this is called
+	 */
+	void close();
+
+	uint64_t rowsWritten() const { return rows; }
+	uint64_t bytesWritten() const { return position; }
+
+	ResultArchiveWriter(ResultArchiveWriter const&) = delete;
+	void operator=(ResultArchiveWriter const&) = delete;
+};
+
+class ResultArchiveReader {
+private:
+	std::string path;
+	ArchiveSettings file_settings;
+	std::vector<uint64_t> offsets;
+	uint64_t index_offset = 0;
+	uint64_t total_rows = 0;
+	uint64_t file_size = 0;
+
+public:
+	/**
+	 * @brief reads the header and the chunk index
+	 * @throws std::runtime_error if the file is missing, incomplete or from
+	 * another version
+	 */
+	ResultArchiveReader(const std::string &path);
+
+	uint64_t rows() const { return total_rows; }
+	uint64_t bytes() const { return file_size; }
+	std::size_t chunks() const { return offsets.size(); }
+	const ArchiveSettings &settings() const { return file_settings; }
+
+	/**
+	 * @brief decompresses one chunk, safe to call from several threads
+	 * @throws std::runtime_error if the chunk is damaged
+	 */
+	std::vector<ComptonResultValues> readChunk(std::size_t chunk) const;
+
+	/**
+	 * @brief decompresses every chunk on a pool of threads
+	 * @param threads 0 for one per core
+	 */
+	std::vector<ComptonResultValues> readAll(unsigned threads = 0) const;
+};
+
+#endif
@@ -0,0 +1,87 @@
+/**
+ * @file ShardManifest.hpp
+ * @brief Shard manifests, for splitting a sweep or a transport run over
+ * machines that share nothing but a filesystem.
+ *
+ * "compton_batch shard-plan" writes a manifest into a job directory: the
+ * job, its options and the range of work of every shard (rows of the
+ * theta x lambda grid, or transport batches). Any number of
+ * "compton_batch run-shard" processes, on any machines, then work through
+ * the shards, claiming each one by creating a lock file in the job
+ * directory, and write one output file per shard. "compton_batch merge"
+ * combines the outputs. Rows are put in place by their index and tallies
+ * are integer sums, so the shards can finish and be merged in any order
+ * and the result is the same as one process running the whole job.
+ *
+ * A manifest is a text file:
+ *   job sweep
+ *   option theta-steps 1801
+ *   option lambda 1,2,3
+ *   shard 0 0 2701
+ *   shard 1 2701 5403
+ */
+
+#ifndef SHARD_MANIFEST_H
+#define SHARD_MANIFEST_H
+
+#include <BatchCommands.hpp>
+#include <Checkpoint.hpp>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct ShardRange {
+	uint64_t first;  // first row or batch
+	uint64_t last;   // one past the last
+};
+
+struct ShardManifest {
+	std::string directory;   // where the manifest and outputs live
+	std::string job;         // "sweep" or "transport"
+	BatchOptions options;    // the options of the job
+	std::vector<ShardRange> shards;
+
+	/**
+	 * @brief a hash of the job and its options, stored in every shard
+	 * output so outputs of another plan are never merged
+	 */
+	uint64_t fingerprint() const;
+
+	std::string manifestPath() const;
+	std::string outputPath(std::size_t shard) const;
+	std::string claimPath(std::size_t shard) const;
+};
+
+/**
+ * @brief the manifest file name inside a job directory
+ */
+const char SHARD_MANIFEST_NAME[] = "manifest.txt";
+
+/**
+ * @brief writes directory/manifest.txt, creating the directory
+ */
+void write_shard_manifest(const ShardManifest &manifest);
+
+/**
+ * @brief reads the manifest of a job directory
+ * @throws std::runtime_error if it is missing or malformed
+ */
+ShardManifest read_shard_manifest(const std::string &directory);
+
+/**
+ * @brief splits [0, total) into shards ranges as even as possible
+ */
+std::vector<ShardRange> split_shard_ranges(uint64_t total, std::size_t shards);
+
+/**
+ * @brief adds a result row to a shard output, exactly (every long double
+ * keeps all of its bits)
+ */
+void put_result_row(CheckpointData &data, const ComptonResultValues &r);
+
+/**
+ * @brief reads back a row written by put_result_row()
+ */
+ComptonResultValues get_result_row(CheckpointData &data);
+
+#endif
@@ -0,0 +1,44 @@
+/**
+ * @file ShiftPlot.hpp
+ * @brief The Compton shift plot (the incident and deflected photons as
+ * waves) as sampled data and a gnuplot script, shared by the calculation
+ * window and the headless renderer ("compton_batch render").
+ *
+ * The script sends the samples inline ('-' data) rather than formulas for
+ * gnuplot to evaluate, so it doesn't depend on gnuplot's sampling and
+ * a renderer can be fed any number of plots one after another.
+ */
+
+#ifndef SHIFT_PLOT_H
+#define SHIFT_PLOT_H
+
+#include <string>
+#include <vector>
+
+struct ShiftPlotData {
+	std::vector<double> x;          // wavelength axis (meters)
+	std::vector<double> incident;   // energy (joules)
+	std::vector<double> deflected;
+};
+
+/**
+ * @brief samples e * cos(2 pi x / lambda) for both photons over
+ * [0, 2 lambda_naught]
+ * @param lambda_prime the scattered wavelength (meters)
+ * @param lambda_naught the incident wavelength (meters)
+ * @param e_naught the incident photon energy (joules)
+ * @param e_prime the scattered photon energy (joules)
+ * @param samples the number of points on each curve
+ */
+ShiftPlotData make_shift_plot(long double lambda_prime,
+			      long double lambda_naught,
+			      long double e_naught, long double e_prime,
+			      std::size_t samples = 400);
+
+/**
+ * @brief the gnuplot commands and inline data that draw the plot on the
+ * current terminal, ending in a newline
+ */
+std::string shift_plot_script(const ShiftPlotData &data);
+
+#endif
@@ -0,0 +1,108 @@
+/**
+ * @file SlabTransport.hpp
+ * @brief Declarations for Monte Carlo photon transport through a slab.
+ *
+ * A photon enters the slab face on, travels a sampled free path, and either
+ * leaves the slab, is absorbed, or Compton scatters. Each scatter is one
+ * collision like a ComptonEvent, and its lambda prime becomes the lambda
+ * naught of the next collision. Histories are run in fixed size batches,
+ * each batch with its own random stream, on a pool of threads.
+ */
+
+#ifndef SLAB_TRANSPORT_H
+#define SLAB_TRANSPORT_H
+
+#include <Checkpoint.hpp>
+#include <cstdint>
+#include <vector>
+
+struct SlabSettings {
+	long double lambda_naught = 10;         // incident wavelength (pm)
+	long double thickness = 0.1;            // meters
+	long double electron_density = 3.343E29; // electrons / m^3 (water)
+	long double absorption = 0;             // other absorption (1 / m)
+	unsigned max_scatters = 100;            // after this, count as absorbed
+	uint64_t histories = 1000000;
+	uint64_t seed = 1;
+	unsigned threads = 0;                   // 0 uses every core
+	std::size_t spectrum_bins = 200;
+	long double spectrum_range = 20;        // wavelength shift (pm) covered
+						// by the exit spectra
+};
+
+// batches are the unit of work and of random streams, so a run with the
+// same seed gives the same tallies on any number of threads
+const uint64_t SLAB_BATCH_SIZE = 1 << 14;
+
+// everything is counted in integers, so merging tallies in any order gives
+// exactly the same result
+struct SlabTally {
+	uint64_t histories = 0;
+	uint64_t transmitted = 0;
+	uint64_t transmitted_unscattered = 0;
+	uint64_t reflected = 0;
+	uint64_t absorbed = 0;
+	uint64_t scatters = 0;
+	uint64_t deposited_energy = 0;          // milli-electron volts
+
+	// number of histories that scattered n times (the last bin counts
+	// max_scatters or more)
+	std::vector<uint64_t> scatter_counts;
+
+	// wavelength of the photons leaving the back (transmitted) and the
+	// front (reflected) of the slab, in bins of spectrum_range / bins
+	// starting at lambda_naught
+	std::vector<uint64_t> transmitted_spectrum;
+	std::vector<uint64_t> reflected_spectrum;
+
+	SlabTally() = default;
+	SlabTally(const SlabSettings &settings);
+	void merge(const SlabTally &other);
+
+	// checkpoint payload, the counters then the three histograms
+	void save(CheckpointData &data) const;
+	void load(CheckpointData &data);
+};
+
+/**
+ * @brief total Klein-Nishina cross-section (m^2) for one electron
+ * @param lambda the photon wavelength in meters
+ */
+long double klein_nishina_total(long double lambda);
+
+/**
+ * @brief runs the histories of one batch and adds them to tally
+ * @param settings the run settings
+ * @param batch the batch index, picks the histories and random stream
+ * @param tally where the results are added
+ */
+void run_slab_batch(const SlabSettings &settings, uint64_t batch,
+		    SlabTally &tally);
+
+/**
+ * @brief runs batches [first, last) on settings.threads threads. Each thread
+ * keeps its own tally and the tallies are merged once the threads finish.
+ * @param settings the run settings
+ * @param first the first batch index
+ * @param last one past the last batch index
+ */
+SlabTally run_slab_batches(const SlabSettings &settings, uint64_t first,
+			   uint64_t last);
+
+/**
+ * @brief the number of batches for settings.histories
+ */
+uint64_t slab_batch_count(const SlabSettings &settings);
+
+/**
+ * @brief a hash of every setting that changes the tallies (everything but
+ * threads), stored in checkpoints so a run isn't resumed with other settings
+ */
+uint64_t slab_settings_fingerprint(const SlabSettings &settings);
+
+/**
+ * @brief runs every history of settings
+ */
+SlabTally run_slab_transport(const SlabSettings &settings);
+
+#endif
@@ -0,0 +1,146 @@
+/**
+ * @file compton.h
+ * @brief The C interface of libcompton, the Compton formulas as a library
+ * without GTK or gnuplot (make lib builds libcompton.a and libcompton.so).
+ *
+ * Every function works on arrays owned by the caller: nothing is
+ * allocated, nothing is printed or read from files, and there is no state
+ * between calls, so the functions are reentrant and can be called from any
+ * number of threads at once. The formulas are evaluated in long double, as
+ * in ComptonKernel.hpp, and rounded to double on the way out unless the
+ * _ld version is used. ComptonLibrary.hpp wraps this for C++.
+ */
+
+#ifndef COMPTON_H
+#define COMPTON_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__GNUC__)
+#define COMPTON_API __attribute__((visibility("default")))
+#else
+#define COMPTON_API
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* changes whenever a struct or function below changes incompatibly */
+#define COMPTON_ABI_VERSION 1
+
+/* status bits of a row, 0 when the inputs are valid and every result is a
+ * finite number, the same bits as ComptonKernel.hpp */
+enum {
+	COMPTON_STATUS_BAD_THETA = 1,         /* theta is NaN or infinite */
+	COMPTON_STATUS_BAD_LAMBDA = 2,        /* lambda is not a positive number */
+	COMPTON_STATUS_NONFINITE_RESULT = 4,  /* a result is NaN or infinite */
+	COMPTON_STATUS_ASIN_DOMAIN = 8,       /* the electron angle's asin got
+					       * an argument past +-1 */
+	COMPTON_STATUS_NBITS = 4
+};
+
+/* the results of one collision, in the units of ComptonResultValues */
+typedef struct compton_result {
+	double theta;                   /* degrees */
+	double lambda_naught;           /* meters */
+	double lambda_prime;            /* meters */
+	double photon_energy_naught;    /* joules */
+	double photon_energy_prime;     /* joules */
+	double photon_momentum_naught;  /* kg m/s */
+	double photon_momentum_prime;   /* kg m/s */
+	double electron_energy;         /* joules */
+	double electron_velocity;       /* m/s */
+	double electron_momentum;       /* kg m/s */
+	double electron_scatter_angle;  /* degrees */
+} compton_result;
+
+/* the same results at full precision, laid out like ComptonResultValues */
+typedef struct compton_result_ld {
+	long double theta;
+	long double lambda_naught;
+	long double lambda_prime;
+	long double photon_energy_naught;
+	long double photon_energy_prime;
+	long double photon_momentum_naught;
+	long double photon_momentum_prime;
+	long double electron_energy;
+	long double electron_velocity;
+	long double electron_momentum;
+	long double electron_scatter_angle;
+} compton_result_ld;
+
+/* how many rows of a batch had each status bit set */
+typedef struct compton_error_counts {
+	uint64_t rows;                          /* rows with any bit set */
+	uint64_t bits[COMPTON_STATUS_NBITS];
+} compton_error_counts;
+
+/**
+ * @brief the COMPTON_ABI_VERSION the library was built with, to check a
+ * shared library against the header a program was compiled with
+ */
+COMPTON_API int compton_abi_version(void);
+
+/**
+ * @brief what a status bit means, for messages
+ * @param bit 0 to COMPTON_STATUS_NBITS - 1
+ * @return a static string, never NULL
+ */
+COMPTON_API const char *compton_status_text(int bit);
+
+/**
+ * @brief evaluates n collisions and checks every row
+ * @param theta n scatter angles in degrees
+ * @param lambda_naught n incident wavelengths in picometers
+ * @param out n results
+ * @param status n status words, or NULL
+ * @param n the number of rows, the arrays may be NULL when it is 0
+ * @param counts set to the rows with each status bit, or NULL
+ * @return the number of rows with a status other than 0
+ */
+COMPTON_API size_t compton_batch_evaluate(const double *theta,
+					  const double *lambda_naught,
+					  compton_result *out, uint32_t *status,
+					  size_t n, compton_error_counts *counts);
+
+/**
+ * @brief compton_batch_evaluate() in long double from end to end
+ */
+COMPTON_API size_t compton_batch_evaluate_ld(const long double *theta,
+					     const long double *lambda_naught,
+					     compton_result_ld *out,
+					     uint32_t *status, size_t n,
+					     compton_error_counts *counts);
+
+/**
+ * @brief only the scattered wavelengths of n collisions
+ * @param theta n scatter angles in degrees
+ * @param lambda_naught n incident wavelengths in picometers
+ * @param lambda_prime n scattered wavelengths in meters
+ * @return the number of rows with invalid inputs or a result that is not
+ * a finite number
+ */
+COMPTON_API size_t compton_batch_lambda_prime(const double *theta,
+					      const double *lambda_naught,
+					      double *lambda_prime, size_t n);
+
+/**
+ * @brief only the Klein-Nishina differential cross-sections of n
+ * collisions
+ * @param theta n scatter angles in degrees
+ * @param lambda_naught n incident wavelengths in picometers
+ * @param cross_section n cross-sections in m^2 / steradian
+ * @return the number of rows with invalid inputs or a result that is not
+ * a finite number
+ */
+COMPTON_API size_t compton_batch_klein_nishina(const double *theta,
+					       const double *lambda_naught,
+					       double *cross_section, size_t n);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -1,12 +1,14 @@
-
 #ifndef GLOBALS_H
 #define GLOBALS_H
 
 // electron mass
-long double M_NAUGHT = 9.10938356E-31; // kg
+const long double M_NAUGHT = 9.10938356E-31; // kg
+
+const long double SPEED_OF_LIGHT = 2.99792458E8; // m / sec
 
-long double SPEED_OF_LIGHT = 2.99792458E8; // m / sec
+const long double PLANCK_CONSTANT = 6.626E-34; // joules * seconds
 
-long double PLANCK_CONSTANT = 6.626E-34; // joules * seconds
+// classical electron radius, used for the Klein-Nishina cross-section
+const long double ELECTRON_RADIUS = 2.8179403262E-15; // m
 
 #endif
@@ -1,5 +1,5 @@
 /**
- * @file graphing.cpp
+ * @file graphing.hpp
  * @author Oisin O'Connell
  * @date 16 Jun 2020
  * @brief header file for 
@@ -8,9 +8,51 @@
  *
  */
 
-#include <gnuplot.h>
+#ifndef GRAPHING_H
+#define GRAPHING_H
+
+#include <AsyncGnuplotPipe.hpp>
+#include <ComptonSpectrum.hpp>
+#include <PlotBuffers.hpp>
+#include <ShiftPlot.hpp>
+#include <memory>
 
 void graph_compton_shift(long double lambda_prime,
 			 long double lambda,
 			 long double e_naught,
 			 long double e_prime);
+
+void graph_broadened_shift(const BinnedSpectrum &broadened,
+			   long double lambda_prime,
+			   const std::string &element);
+
+// the angular views, all drawn from the same pushed data
+enum class ScatterView {
+	LAMBDA_PRIME,   // polar lambda'(theta)
+	ELECTRON_PHI,   // polar phi(theta)
+	INTENSITY,      // polar Klein-Nishina intensity
+	DIRECTIONS_3D   // photon and electron directions around the axis
+};
+
+// keeps a gnuplot process with the sweep's data loaded as datablocks, so
+// switching between views only sends a plot command
+class ScatterPlotter {
+private:
+	std::unique_ptr<AsyncGnuplotPipe> gp;
+	ScatterPlotBuffers buffers;
+	bool dirty = false;
+	std::size_t max_points;
+	std::size_t azimuth_steps;
+
+	void pushData();
+
+public:
+	ScatterPlotter(std::size_t max_points = 2000,
+		       std::size_t azimuth_steps = 24) :
+		max_points{max_points}, azimuth_steps{azimuth_steps} {}
+
+	void setData(ScatterPlotBuffers buffers);
+	void show(ScatterView view);
+};
+
+#endif
@@ -0,0 +1,141 @@
+/**
+ * @file ShardManifest.cpp
+ * @brief Reading and writing shard manifests, see ShardManifest.hpp
+ */
+
+#include <ShardManifest.hpp>
+#include <Checkpoint.hpp>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+uint64_t ShardManifest::fingerprint() const
+{
+	std::string text = job;
+	for (const auto &option : options.values)
+		text += '\n' + option.first + ' ' + option.second;
+	return fnv1a_hash(text.data(), text.size());
+}
+
+std::string ShardManifest::manifestPath() const
+{
+	return directory + "/" + SHARD_MANIFEST_NAME;
+}
+
+std::string ShardManifest::outputPath(std::size_t shard) const
+{
+	return directory + "/shard-" + std::to_string(shard) + ".out";
+}
+
+std::string ShardManifest::claimPath(std::size_t shard) const
+{
+	return directory + "/shard-" + std::to_string(shard) + ".claim";
+}
+
+void write_shard_manifest(const ShardManifest &manifest)
+{
+	std::filesystem::create_directories(manifest.directory);
+	std::ofstream out(manifest.manifestPath());
+	if (!out)
+		throw std::runtime_error("could not write "
+					 + manifest.manifestPath());
+
+	out << "# compton_batch shard manifest, run the shards with\n"
+	    << "# compton_batch run-shard --job-dir " << manifest.directory
+	    << '\n'
+	    << "job " << manifest.job << '\n';
+	for (const auto &option : manifest.options.values)
+		out << "option " << option.first << ' ' << option.second << '\n';
+	for (std::size_t i = 0; i < manifest.shards.size(); ++i)
+		out << "shard " << i << ' ' << manifest.shards[i].first << ' '
+		    << manifest.shards[i].last << '\n';
+}
+
+ShardManifest read_shard_manifest(const std::string &directory)
+{
+	ShardManifest manifest;
+	manifest.directory = directory;
+	std::ifstream in(manifest.manifestPath());
+	if (!in)
+		throw std::runtime_error("could not read "
+					 + manifest.manifestPath());
+
+	std::string line;
+	while (std::getline(in, line)) {
+		if (line.empty() || line[0] == '#')
+			continue;
+		std::istringstream fields(line);
+		std::string kind;
+		fields >> kind;
+		if (kind == "job") {
+			fields >> manifest.job;
+		} else if (kind == "option") {
+			std::string key, value;
+			fields >> key >> std::ws;
+			std::getline(fields, value);
+			manifest.options.values[key] = value;
+		} else if (kind == "shard") {
+			std::size_t index;
+			ShardRange range;
+			if (!(fields >> index >> range.first >> range.last) ||
+			    index != manifest.shards.size())
+				throw std::runtime_error("bad shard line in "
+							 + manifest.manifestPath()
+							 + ": " + line);
+			manifest.shards.push_back(range);
+		} else {
+			throw std::runtime_error("unknown line in "
+						 + manifest.manifestPath() + ": "
+						 + line);
+		}
+	}
+
+	if (manifest.job != "sweep" && manifest.job != "transport")
+		throw std::runtime_error(manifest.manifestPath()
+					 + " has no sweep or transport job");
+	if (manifest.shards.empty())
+		throw std::runtime_error(manifest.manifestPath()
+					 + " has no shards");
+	return manifest;
+}
+
+std::vector<ShardRange> split_shard_ranges(uint64_t total, std::size_t shards)
+{
+	std::vector<ShardRange> ranges;
+	for (std::size_t i = 0; i < shards; ++i)
+		ranges.push_back({total * i / shards, total * (i + 1) / shards});
+	return ranges;
+}
+
+void put_result_row(CheckpointData &data, const ComptonResultValues &r)
+{
+	data.putLongDouble(r.theta);
+	data.putLongDouble(r.lambda_naught);
+	data.putLongDouble(r.lambda_prime);
+	data.putLongDouble(r.photon_energy_naught);
+	data.putLongDouble(r.photon_energy_prime);
+	data.putLongDouble(r.photon_momentum_naught);
+	data.putLongDouble(r.photon_momentum_prime);
+	data.putLongDouble(r.electron_energy);
+	data.putLongDouble(r.electron_velocity);
+	data.putLongDouble(r.electron_momentum);
+	data.putLongDouble(r.electron_scatter_angle);
+}
+
+ComptonResultValues get_result_row(CheckpointData &data)
+{
+	ComptonResultValues r;
+	r.theta = data.getLongDouble();
+	r.lambda_naught = data.getLongDouble();
+	r.lambda_prime = data.getLongDouble();
+	r.photon_energy_naught = data.getLongDouble();
+	r.photon_energy_prime = data.getLongDouble();
+	r.photon_momentum_naught = data.getLongDouble();
+	r.photon_momentum_prime = data.getLongDouble();
+	r.electron_energy = data.getLongDouble();
+	r.electron_velocity = data.getLongDouble();
+	r.electron_momentum = data.getLongDouble();
+	r.electron_scatter_angle = data.getLongDouble();
+	return r;
+}
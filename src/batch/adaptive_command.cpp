@@ -0,0 +1,143 @@
+/**
+ * @file adaptive_command.cpp
+ * @brief "compton_batch adaptive", adaptive sweeps over theta for one or
+ * more incident wavelengths. With --check n every curve is compared with a
+ * dense uniform sweep of n angles, and with uniform sweeps of increasing
+ * size, to show how many evaluations the same accuracy takes without
+ * refinement.
+ */
+
+#include <AdaptiveSweep.hpp>
+#include <BatchCommands.hpp>
+#include <ComptonSweep.hpp>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+/**
+ * @brief the largest difference between the curve, interpolated linearly,
+ * and the reference rows, as a fraction of each column's range
+ */
+static long double max_interpolation_error(
+	const AdaptiveCurve &curve,
+	const std::vector<ComptonResultValues> &reference)
+{
+	long double worst = 0;
+	for (int column = 2; column <= 10; ++column) {
+		long double low = INFINITY, high = -INFINITY;
+		for (const ComptonResultValues &r : reference) {
+			long double v = result_column(r, column);
+			if (std::isfinite(v)) {
+				low = std::min(low, v);
+				high = std::max(high, v);
+			}
+		}
+		if (!(high > low))
+			continue;
+		// both are sorted by theta, so one walk along the curve finds
+		// the interval of every reference row
+		const std::vector<ComptonResultValues> &rows = curve.rows;
+		std::size_t j = 1;
+		for (const ComptonResultValues &r : reference) {
+			while (j + 1 < rows.size() && rows[j].theta < r.theta)
+				j++;
+			const ComptonResultValues &a = rows[j - 1], &b = rows[j];
+			long double t = (r.theta - a.theta) / (b.theta - a.theta);
+			long double guess = result_column(a, column) * (1 - t)
+				+ result_column(b, column) * t;
+			long double v = result_column(r, column);
+			if (std::isfinite(v) && std::isfinite(guess))
+				worst = std::max(worst,
+						 fabsl(guess - v) / (high - low));
+		}
+	}
+	return worst;
+}
+
+/**
+ * @brief a uniform sweep of steps angles as a curve
+ */
+static AdaptiveCurve uniform_curve(const AdaptiveSettings &settings,
+				   std::size_t steps, long double lambda)
+{
+	AdaptiveCurve curve;
+	curve.lambda_naught = lambda;
+	curve.rows = ComptonSweep(settings.theta_min, settings.theta_max,
+				  steps, lambda).getResults();
+	curve.evaluations = steps;
+	return curve;
+}
+
+int adaptive_command(const BatchOptions &options)
+{
+	std::vector<long double> lambdas =
+		parse_number_list(options.get("lambda", "10"));
+	if (lambdas.empty())
+		throw std::invalid_argument("--lambda needs at least one value");
+
+	AdaptiveSettings settings;
+	settings.theta_min = options.getNumber("theta-min", settings.theta_min);
+	settings.theta_max = options.getNumber("theta-max", settings.theta_max);
+	settings.initial_steps = options.getNumber("initial-steps",
+						   settings.initial_steps);
+	settings.tolerance = options.getNumber("tolerance", settings.tolerance);
+	settings.min_spacing = options.getNumber("min-spacing",
+						 settings.min_spacing);
+	settings.max_points = options.getNumber("max-points",
+						settings.max_points);
+	settings.threads = options.getNumber("threads", settings.threads);
+	std::size_t check = options.getNumber("check", 0);
+
+	std::ofstream out;
+	if (options.has("out")) {
+		out.open(options.get("out", ""));
+		if (!out)
+			throw std::runtime_error("could not write "
+						 + options.get("out", ""));
+	}
+
+	for (long double lambda : lambdas) {
+		auto start = std::chrono::steady_clock::now();
+		AdaptiveCurve curve = adaptive_sweep(lambda, settings);
+		std::chrono::duration<double> time =
+			std::chrono::steady_clock::now() - start;
+
+		// one block per wavelength, separated by a blank line for gnuplot
+		if (out) {
+			write_result_rows(out, curve.rows);
+			out << '\n';
+		}
+
+		std::cout << "Lambda (pm): " << (double) lambda << '\n'
+			  << "  Evaluations: " << curve.evaluations << '\n'
+			  << "  Passes: " << curve.passes << '\n'
+			  << "  Time (s): " << time.count() << '\n';
+		if (check < 2)
+			continue;
+
+		std::vector<ComptonResultValues> reference =
+			uniform_curve(settings, check, lambda).rows;
+		long double error = max_interpolation_error(curve, reference);
+		long double same_count = max_interpolation_error(
+			uniform_curve(settings, curve.evaluations, lambda),
+			reference);
+
+		// double a uniform grid until it is as accurate as the curve
+		std::size_t steps = settings.initial_steps;
+		while (steps < check &&
+		       max_interpolation_error(uniform_curve(settings, steps,
+							     lambda),
+					       reference) > error)
+			steps = 2 * steps - 1;
+
+		std::cout << "  Max error against " << check
+			  << " uniform angles: " << (double) error << '\n'
+			  << "  Uniform grid of the same size: "
+			  << (double) same_count << '\n'
+			  << "  Uniform angles for the same error: "
+			  << (steps < check ? "" : ">= ") << steps << '\n';
+	}
+	return 0;
+}
@@ -0,0 +1,130 @@
+/**
+ * @file compton_batch.cpp
+ * @brief headless entry point for the bulk calculations, runs without GTK
+ * or gnuplot:
+ *
+ * ./compton_batch <command> [--key value ...]
+ */
+
+#include <BatchCommands.hpp>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+struct BatchCommand {
+	const char *name;
+	int (*run)(const BatchOptions &options);
+	const char *usage;
+};
+
+static const BatchCommand commands[] = {
+	{"spectrum", spectrum_command,
+	 "--input file.txt [--theta deg | --all-angles] [--bins n]\n"
+	 "\t[--theta-steps n] [--photon-out file] [--electron-out file]"},
+	{"profile", profile_command,
+	 "[--element H] [--profile-dir dir] [--theta deg] [--lambda pm]\n"
+	 "\t[--bins n] [--out file] [--samples n] [--seed n]"},
+	{"transport", transport_command,
+	 "[--lambda pm] [--thickness m] [--density electrons/m^3]\n"
+	 "\t[--absorption 1/m] [--histories n] [--seed n] [--threads n]\n"
+	 "\t[--max-scatters n] [--bins n] [--range pm]\n"
+	 "\t[--transmitted-out file] [--reflected-out file]\n"
+	 "\t[--checkpoint file [--checkpoint-interval s] [--resume]]"},
+	{"sweep", sweep_command,
+	 "[--theta-min deg] [--theta-max deg] [--theta-steps n]\n"
+	 "\t[--lambda pm[,pm...]] [--out file]\n"
+	 "\t[--archive file [archive options]]\n"
+	 "\t[--checkpoint file [--checkpoint-interval s] [--resume]]"},
+	{"adaptive", adaptive_command,
+	 "[--theta-min deg] [--theta-max deg] [--initial-steps n]\n"
+	 "\t[--tolerance fraction] [--min-spacing deg] [--max-points n]\n"
+	 "\t[--threads n] [--lambda pm[,pm...]] [--out file] [--check n]"},
+	{"shard-plan", shard_plan_command,
+	 "--job-dir dir --shards n [--job sweep|transport]\n"
+	 "\t[sweep or transport options]"},
+	{"run-shard", run_shard_command,
+	 "--job-dir dir [--shard n] [--threads n]"},
+	{"merge", merge_command,
+	 "--job-dir dir [--out file] [--archive file [archive options]]\n"
+	 "\t[--threads n] [--transmitted-out file] [--reflected-out file]"},
+	{"unpack", unpack_command,
+	 "--in archive [--out file] [--threads n]\n"
+	 "\tarchive options: [--precision p | column=p,...] (p is long-double,\n"
+	 "\tdouble or float) [--error e | column=e,...] [--keep-derived]\n"
+	 "\t[--chunk-rows n]"},
+	{"render", render_command,
+	 "[--theta deg[,deg...]] [--lambda pm[,pm...]] [--cases file]\n"
+	 "\t[--format png|svg] [--out-dir dir] [--size w,h] [--samples n]\n"
+	 "\t[--renderers n]"},
+	{"serve", serve_command, "[--socket path]"},
+	{"loadgen", loadgen_command,
+	 "[--socket path] [--clients n] [--depth n] [--requests n]"},
+};
+
+static void print_usage()
+{
+	std::cerr << "usage: compton_batch <command> [--key value ...]\n";
+	for (const BatchCommand &c : commands)
+		std::cerr << "  " << c.name << ' ' << c.usage << '\n';
+}
+
+bool BatchOptions::has(const std::string &key) const
+{
+	return values.count(key) != 0;
+}
+
+std::string BatchOptions::get(const std::string &key,
+			      const std::string &fallback) const
+{
+	auto it = values.find(key);
+	return it == values.end() ? fallback : it->second;
+}
+
+long double BatchOptions::getNumber(const std::string &key,
+				    long double fallback) const
+{
+	auto it = values.find(key);
+	return it == values.end() ? fallback : std::stold(it->second);
+}
+
+/**
+ * @brief parses "--key value" pairs, a "--flag" with no value is set to "1"
+ */
+BatchOptions parse_batch_options(int argc, char **argv, int first)
+{
+	BatchOptions options;
+	for (int i = first; i < argc; ++i) {
+		if (strncmp(argv[i], "--", 2) != 0)
+			throw std::invalid_argument(std::string("unexpected argument ")
+						    + argv[i]);
+		std::string key = argv[i] + 2;
+		if (i + 1 < argc && strncmp(argv[i + 1], "--", 2) != 0)
+			options.values[key] = argv[++i];
+		else
+			options.values[key] = "1";
+	}
+	return options;
+}
+
+int main(int argc, char **argv)
+{
+	if (argc < 2) {
+		print_usage();
+		return 2;
+	}
+
+	for (const BatchCommand &c : commands) {
+		if (strcmp(argv[1], c.name) != 0)
+			continue;
+		try {
+			return c.run(parse_batch_options(argc, argv, 2));
+		} catch (const std::exception &e) {
+			std::cerr << "compton_batch " << c.name << ": "
+				  << e.what() << '\n';
+			return 1;
+		}
+	}
+
+	print_usage();
+	return 2;
+}
@@ -0,0 +1,139 @@
+/**
+ * @file loadgen_command.cpp
+ * @brief "compton_batch loadgen", a load generator for the query server.
+ * Every client thread keeps --depth requests in flight on its own
+ * connection and records the latency of each one.
+ */
+
+#include <BatchCommands.hpp>
+#include <ComptonProtocol.hpp>
+#include <ComptonRandom.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+
+typedef std::chrono::steady_clock loadgen_clock;
+
+/**
+ * @brief one client: sends requests, keeping depth of them unanswered,
+ * until count have been answered
+ * @param latencies receives the latency of every request in microseconds
+ * @return false if the connection failed
+ */
+static bool run_client(const std::string &path, uint64_t count,
+		       unsigned depth, uint64_t seed,
+		       std::vector<double> &latencies)
+{
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	sockaddr_un address = {};
+	address.sun_family = AF_UNIX;
+	strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+	if (fd < 0 || connect(fd, (sockaddr *) &address, sizeof(address)) != 0) {
+		if (fd >= 0)
+			close(fd);
+		return false;
+	}
+
+	ComptonRandom rng(seed);
+	std::vector<loadgen_clock::time_point> sent(count);
+	std::vector<ComptonRequest> burst;
+	uint64_t next = 0, answered = 0;
+	std::vector<char> in;
+	char chunk[16384];
+
+	latencies.reserve(count);
+	while (answered < count) {
+		// top the pipeline back up to depth requests
+		burst.clear();
+		while (next < count && next - answered < depth) {
+			ComptonRequest request = {};
+			request.id = (uint32_t) next;
+			request.theta = 180 * rng.uniform();
+			request.lambda_naught = 1 + 99 * rng.uniform();
+			sent[next++] = loadgen_clock::now();
+			burst.push_back(request);
+		}
+		const char *bytes = (const char *) burst.data();
+		std::size_t size = burst.size() * sizeof(ComptonRequest);
+		while (size > 0) {
+			ssize_t n = write(fd, bytes, size);
+			if (n <= 0) {
+				close(fd);
+				return false;
+			}
+			bytes += n;
+			size -= n;
+		}
+
+		ssize_t n = read(fd, chunk, sizeof(chunk));
+		if (n <= 0) {
+			close(fd);
+			return false;
+		}
+		in.insert(in.end(), chunk, chunk + n);
+
+		auto now = loadgen_clock::now();
+		std::size_t used = 0;
+		while (in.size() - used >= sizeof(ComptonResponse)) {
+			ComptonResponse response;
+			memcpy(&response, in.data() + used, sizeof(response));
+			used += sizeof(response);
+			std::chrono::duration<double, std::micro> latency =
+				now - sent[response.id];
+			latencies.push_back(latency.count());
+			answered++;
+		}
+		in.erase(in.begin(), in.begin() + used);
+	}
+	close(fd);
+	return true;
+}
+
+int loadgen_command(const BatchOptions &options)
+{
+	std::string path = options.get("socket", "/tmp/compton.sock");
+	unsigned clients = (unsigned) options.getNumber("clients", 8);
+	unsigned depth = (unsigned) options.getNumber("depth", 16);
+	uint64_t requests = (uint64_t) options.getNumber("requests", 100000);
+	if (clients == 0 || depth == 0)
+		throw std::invalid_argument("--clients and --depth must be "
+					    "positive");
+
+	std::vector<std::vector<double>> latencies(clients);
+	std::vector<char> ok(clients, 0);
+	std::vector<std::thread> threads;
+	auto start = loadgen_clock::now();
+	for (unsigned t = 0; t < clients; ++t)
+		threads.emplace_back([&, t]() {
+			ok[t] = run_client(path, requests / clients, depth,
+					   t + 1, latencies[t]);
+		});
+	for (std::thread &t : threads)
+		t.join();
+	std::chrono::duration<double> elapsed = loadgen_clock::now() - start;
+
+	std::vector<double> all;
+	for (unsigned t = 0; t < clients; ++t) {
+		if (!ok[t])
+			throw std::runtime_error("client lost its connection to "
+						 + path);
+		all.insert(all.end(), latencies[t].begin(), latencies[t].end());
+	}
+	if (all.empty())
+		throw std::runtime_error("no requests were answered");
+	std::sort(all.begin(), all.end());
+
+	std::cout << "Requests: " << all.size() << '\n'
+		  << "Throughput (requests/s): " << all.size() / elapsed.count()
+		  << '\n'
+		  << "p50 latency (us): " << all[all.size() / 2] << '\n'
+		  << "p99 latency (us): " << all[all.size() * 99 / 100] << '\n'
+		  << "Max latency (us): " << all.back() << '\n';
+	return 0;
+}
@@ -0,0 +1,232 @@
+/**
+ * @file merge_command.cpp
+ * @brief "compton_batch merge", combines the shard outputs of a job
+ * directory, see ShardManifest.hpp. The outputs are read on a pool of
+ * threads. Sweep shards are contiguous ranges of rows, so they are written
+ * out in shard order as they arrive, with only a few shards read ahead,
+ * and the whole grid is never held in memory. Transport tallies are
+ * integer sums, so they are merged in whatever order the shards come.
+ */
+
+#include <BatchCommands.hpp>
+#include <ShardManifest.hpp>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+/**
+ * @brief reads one shard output and checks it belongs to this manifest
+ * and shard
+ */
+static CheckpointData read_shard_output(const ShardManifest &manifest,
+					std::size_t shard, uint32_t kind)
+{
+	CheckpointData data = read_checkpoint(manifest.outputPath(shard), kind);
+	if (data.getU64() != manifest.fingerprint() ||
+	    data.getU64() != shard ||
+	    data.getU64() != manifest.shards[shard].first ||
+	    data.getU64() != manifest.shards[shard].last)
+		throw std::runtime_error(manifest.outputPath(shard)
+					 + " is from another shard plan");
+	return data;
+}
+
+/**
+ * @brief reads the shards of a sweep on threads threads, at most threads
+ * shards ahead of the one being written, and writes their rows in order
+ * to out and archive (either may be null)
+ * @return the number of rows written
+ */
+static uint64_t merge_sweep_shards(const ShardManifest &manifest,
+				   unsigned threads, std::ostream *out,
+				   ResultArchiveWriter *archive)
+{
+	// the shards have to cover the grid in order, one after another
+	std::size_t shards = manifest.shards.size();
+	uint64_t covered = 0;
+	for (const ShardRange &range : manifest.shards) {
+		if (range.first != covered)
+			throw std::runtime_error(manifest.manifestPath()
+						 + " has shards out of order");
+		covered = range.last;
+	}
+	if (covered != sweep_job_from_options(manifest.options).rows())
+		throw std::runtime_error(manifest.manifestPath()
+					 + " doesn't cover the whole sweep");
+
+	std::vector<std::vector<ComptonResultValues>> rows(shards);
+	std::vector<char> ready(shards, 0);
+	std::size_t next = 0, written = 0;
+	std::mutex lock;
+	std::condition_variable changed;
+	std::string error;
+	std::vector<std::thread> pool;
+	for (unsigned t = 0; t < threads; ++t)
+		pool.emplace_back([&]() {
+			for (;;) {
+				std::unique_lock<std::mutex> guard(lock);
+				changed.wait(guard, [&]() {
+					return !error.empty() || next >= shards ||
+						next < written + threads;
+				});
+				if (!error.empty() || next >= shards)
+					return;
+				std::size_t shard = next++;
+				guard.unlock();
+
+				std::vector<ComptonResultValues> part;
+				std::string failed;
+				try {
+					CheckpointData data = read_shard_output(
+						manifest, shard,
+						CHECKPOINT_SWEEP_SHARD);
+					ShardRange range = manifest.shards[shard];
+					part.reserve(range.last - range.first);
+					for (uint64_t i = range.first;
+					     i < range.last; ++i)
+						part.push_back(get_result_row(data));
+				} catch (const std::exception &e) {
+					failed = e.what();
+				}
+
+				guard.lock();
+				if (!failed.empty())
+					error = failed;
+				rows[shard].swap(part);
+				ready[shard] = 1;
+				changed.notify_all();
+			}
+		});
+
+	uint64_t total = 0;
+	for (std::size_t shard = 0; shard < shards; ++shard) {
+		std::vector<ComptonResultValues> part;
+		{
+			std::unique_lock<std::mutex> guard(lock);
+			changed.wait(guard, [&]() {
+				return !error.empty() || ready[shard];
+			});
+			if (!error.empty())
+				break;
+			part.swap(rows[shard]);
+		}
+		if (out)
+			write_result_rows(*out, part);
+		if (archive)
+			archive->write(part);
+		total += part.size();
+
+		std::lock_guard<std::mutex> guard(lock);
+		written++;
+		changed.notify_all();
+	}
+	for (std::thread &t : pool)
+		t.join();
+	if (!error.empty())
+		throw std::runtime_error(error);
+	return total;
+}
+
+int merge_command(const BatchOptions &options)
+{
+	ShardManifest manifest = read_shard_manifest(options.get("job-dir",
+								 "."));
+	bool sweep = manifest.job == "sweep";
+	if (sweep && !options.has("out") && !options.has("archive"))
+		throw std::invalid_argument("merging a sweep needs --out or "
+					    "--archive");
+
+	// every shard is there before anything is read
+	std::string missing;
+	for (std::size_t i = 0; i < manifest.shards.size(); ++i)
+		if (!std::ifstream(manifest.outputPath(i)))
+			missing += " " + std::to_string(i);
+	if (!missing.empty())
+		throw std::runtime_error("missing shards:" + missing);
+
+	unsigned threads = options.getNumber("threads", 0);
+	if (threads == 0)
+		threads = std::max(1u, std::thread::hardware_concurrency());
+	auto start = std::chrono::steady_clock::now();
+
+	if (sweep) {
+		std::ofstream out;
+		if (options.has("out")) {
+			out.open(options.get("out", ""));
+			if (!out)
+				throw std::runtime_error("could not write "
+							 + options.get("out", ""));
+			write_result_header(out);
+		}
+		std::unique_ptr<ResultArchiveWriter> archive;
+		if (options.has("archive"))
+			archive = std::make_unique<ResultArchiveWriter>(
+				options.get("archive", ""),
+				archive_settings_from_options(options));
+
+		uint64_t rows = merge_sweep_shards(manifest, threads,
+						   out.is_open() ? &out : nullptr,
+						   archive.get());
+		if (out.is_open()) {
+			out.close();
+			if (!out)
+				throw std::runtime_error("could not write "
+							 + options.get("out", ""));
+		}
+		if (archive) {
+			archive->close();
+			print_archive_size(rows, archive->bytesWritten());
+		}
+		std::cout << "Rows: " << rows << '\n';
+	} else {
+		SlabSettings settings = slab_settings_from_options(
+			manifest.options);
+		SlabTally tally(settings);
+		std::atomic<std::size_t> next{0};
+		std::mutex lock;
+		std::string error;
+		std::vector<std::thread> pool;
+		for (unsigned t = 0; t < threads; ++t)
+			pool.emplace_back([&]() {
+				std::size_t shard;
+				while ((shard = next.fetch_add(1)) <
+				       manifest.shards.size()) {
+					try {
+						SlabTally part(settings);
+						CheckpointData data =
+							read_shard_output(manifest, shard,
+								CHECKPOINT_TRANSPORT_SHARD);
+						part.load(data);
+						std::lock_guard<std::mutex> guard(lock);
+						tally.merge(part);
+					} catch (const std::exception &e) {
+						std::lock_guard<std::mutex> guard(lock);
+						error = e.what();
+					}
+				}
+			});
+		for (std::thread &t : pool)
+			t.join();
+		if (!error.empty())
+			throw std::runtime_error(error);
+
+		print_slab_tally(tally);
+		if (options.has("transmitted-out"))
+			write_exit_spectrum(tally.transmitted_spectrum, settings,
+					    options.get("transmitted-out", ""));
+		if (options.has("reflected-out"))
+			write_exit_spectrum(tally.reflected_spectrum, settings,
+					    options.get("reflected-out", ""));
+	}
+	std::chrono::duration<double> time =
+		std::chrono::steady_clock::now() - start;
+	std::cout << "Shards: " << manifest.shards.size() << '\n'
+		  << "Read and merged in (s): " << time.count() << '\n';
+	return 0;
+}
@@ -0,0 +1,53 @@
+/**
+ * @file profile_command.cpp
+ * @brief "compton_batch profile", the Doppler broadened scattered wavelength
+ * for a bound electron, either as a distribution or as sampled events
+ */
+
+#include <BatchCommands.hpp>
+#include <ComptonKernel.hpp>
+#include <ComptonProfile.hpp>
+#include <chrono>
+#include <iostream>
+#include <random>
+
+int profile_command(const BatchOptions &options)
+{
+	ComptonProfile profile = load_compton_profile(
+		options.get("element", "H"),
+		options.get("profile-dir", "data/compton_profiles"));
+	long double theta = options.getNumber("theta", 30);
+	long double lambda = options.getNumber("lambda", 10);
+
+	BinnedSpectrum broadened = profile.broadenedSpectrum(theta, lambda,
+		(std::size_t) options.getNumber("bins", 200));
+	write_spectrum(broadened, options.get("out", "broadened.txt"));
+
+	ComptonResultValues free_electron = compton_evaluate(theta, lambda);
+	ComptonResultValues median =
+		compton_evaluate_bound(theta, lambda, profile, 0.5);
+	std::cout << "Free electron lambda prime (m): "
+		  << free_electron.lambda_prime << '\n'
+		  << "Median bound lambda prime (m): "
+		  << median.lambda_prime << '\n';
+
+	// time the per-event sampling, which should not depend on the size
+	// of the profile table
+	std::size_t samples = (std::size_t) options.getNumber("samples", 0);
+	if (samples == 0)
+		return 0;
+
+	std::mt19937_64 rng((unsigned long) options.getNumber("seed", 1));
+	std::uniform_real_distribution<double> uniform(0, 1);
+	long double sum = 0;
+	auto start = std::chrono::steady_clock::now();
+	for (std::size_t i = 0; i < samples; ++i)
+		sum += compton_evaluate_bound(theta, lambda, profile,
+					      uniform(rng)).lambda_prime;
+	std::chrono::duration<double> elapsed =
+		std::chrono::steady_clock::now() - start;
+
+	std::cout << "Mean sampled lambda prime (m): " << sum / samples << '\n'
+		  << "Samples per second: " << samples / elapsed.count() << '\n';
+	return 0;
+}
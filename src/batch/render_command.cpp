@@ -0,0 +1,198 @@
+/**
+ * @file render_command.cpp
+ * @brief "compton_batch render", draws the Compton shift plot of many
+ * (theta, lambda) cases to PNG or SVG files without opening any windows.
+ *
+ * Each of --renderers threads starts one gnuplot process, sets its
+ * terminal once, then takes cases from a shared counter and streams each
+ * plot (output file, commands and inline data) down its pipe. gnuplot
+ * starts once per renderer instead of once per plot, and the renderers
+ * draw in parallel, so the plots per second grow with the cores.
+ *
+ * The plots are named by case number, shift_000000.png and so on, and
+ * index.txt in the same directory gives the theta and lambda of each, so
+ * cases that only differ past the digits a file name would show never
+ * overwrite each other.
+ */
+
+#include <BatchCommands.hpp>
+#include <ComptonKernel.hpp>
+#include <ShiftPlot.hpp>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+struct RenderCase {
+	long double theta;    // degrees
+	long double lambda;   // picometers
+};
+
+/**
+ * @brief the file name of case i
+ */
+static std::string plot_name(std::size_t i, const std::string &format)
+{
+	char name[64];
+	snprintf(name, sizeof(name), "shift_%06zu.%s", i, format.c_str());
+	return name;
+}
+
+/**
+ * @brief text as a gnuplot single quoted string, where a quote is written
+ * twice
+ * @throws std::invalid_argument if it holds a line break, which ends a
+ * gnuplot command even inside quotes
+ */
+static std::string gnuplot_quoted(const std::string &text)
+{
+	if (text.find_first_of("\r\n") != std::string::npos)
+		throw std::invalid_argument("\"" + text + "\" can't be passed to "
+					    "gnuplot, it has a line break");
+	std::string quoted = "'";
+	for (char c : text) {
+		quoted += c;
+		if (c == '\'')
+			quoted += c;
+	}
+	return quoted + "'";
+}
+
+/**
+ * @brief writes index.txt, the file, theta and lambda of every case
+ */
+static void write_plot_index(const std::string &directory,
+			     const std::vector<RenderCase> &cases,
+			     const std::string &format)
+{
+	std::string path = directory + "/index.txt";
+	std::ofstream index(path);
+	index << "# file theta lambda\n";
+	index.precision(21);
+	for (std::size_t i = 0; i < cases.size(); ++i)
+		index << plot_name(i, format) << ' ' << cases[i].theta << ' '
+		      << cases[i].lambda << '\n';
+	if (!index)
+		throw std::runtime_error("could not write " + path);
+}
+
+/**
+ * @brief the cases from --cases (a file of "theta lambda" rows, # for
+ * comments) or every combination of --theta and --lambda
+ */
+static std::vector<RenderCase> render_cases(const BatchOptions &options)
+{
+	std::vector<RenderCase> cases;
+	if (options.has("cases")) {
+		std::string path = options.get("cases", "");
+		std::ifstream in(path);
+		if (!in)
+			throw std::runtime_error("could not read " + path);
+		std::string line;
+		while (std::getline(in, line)) {
+			if (line.empty() || line[0] == '#')
+				continue;
+			RenderCase c;
+			if (sscanf(line.c_str(), "%Lf %Lf", &c.theta,
+				   &c.lambda) != 2)
+				throw std::runtime_error("bad line in " + path
+							 + ": " + line);
+			cases.push_back(c);
+		}
+		return cases;
+	}
+
+	std::vector<long double> thetas =
+		parse_number_list(options.get("theta", "30"));
+	for (long double lambda : parse_number_list(options.get("lambda", "10")))
+		for (long double theta : thetas)
+			cases.push_back({theta, lambda});
+	return cases;
+}
+
+int render_command(const BatchOptions &options)
+{
+	std::vector<RenderCase> cases = render_cases(options);
+	if (cases.empty())
+		throw std::invalid_argument("there are no cases to render");
+	std::string format = options.get("format", "png");
+	if (format != "png" && format != "svg")
+		throw std::invalid_argument("--format must be png or svg");
+	std::string directory = options.get("out-dir", "plots");
+	gnuplot_quoted(directory);  // throws before anything is written
+	std::filesystem::create_directories(directory);
+	write_plot_index(directory, cases, format);
+	std::size_t samples = options.getNumber("samples", 400);
+	std::string terminal = format == "png"
+		? "set terminal pngcairo size " : "set terminal svg size ";
+	terminal += options.get("size", "800,600") + "\n";
+
+	unsigned renderers = options.getNumber("renderers", 0);
+	if (renderers == 0)
+		renderers = std::max(1u, std::thread::hardware_concurrency());
+	renderers = std::min<std::size_t>(renderers, cases.size());
+
+	// a renderer that dies fails its writes instead of killing us
+	signal(SIGPIPE, SIG_IGN);
+
+	std::atomic<std::size_t> next{0};
+	std::atomic<std::size_t> rendered{0};
+	std::mutex lock;
+	std::string error;
+	auto start = std::chrono::steady_clock::now();
+
+	std::vector<std::thread> pool;
+	for (unsigned r = 0; r < renderers; ++r)
+		pool.emplace_back([&]() {
+			FILE *gnuplot = popen("gnuplot", "w");
+			if (!gnuplot) {
+				std::lock_guard<std::mutex> guard(lock);
+				error = "could not start gnuplot";
+				return;
+			}
+			bool ok = fputs(terminal.c_str(), gnuplot) >= 0;
+
+			std::size_t i;
+			while (ok && (i = next.fetch_add(1)) < cases.size()) {
+				const RenderCase &c = cases[i];
+				ComptonResultValues r = compton_evaluate(c.theta,
+									 c.lambda);
+				std::string plot = "set output " + gnuplot_quoted(
+					directory + "/" + plot_name(i, format))
+					+ "\n";
+				plot += shift_plot_script(make_shift_plot(
+					r.lambda_prime, r.lambda_naught,
+					r.photon_energy_naught,
+					r.photon_energy_prime, samples));
+				plot += "unset output\n";
+				ok = fwrite(plot.data(), 1, plot.size(), gnuplot)
+					== plot.size();
+				if (ok)
+					rendered++;
+			}
+
+			// gnuplot has drawn everything once it exits
+			if (pclose(gnuplot) != 0 || !ok) {
+				std::lock_guard<std::mutex> guard(lock);
+				error = "a gnuplot renderer failed";
+			}
+		});
+	for (std::thread &t : pool)
+		t.join();
+	std::chrono::duration<double> time =
+		std::chrono::steady_clock::now() - start;
+	if (!error.empty())
+		throw std::runtime_error(error);
+
+	std::cout << "Plots: " << rendered << " in " << directory << '\n'
+		  << "Renderers: " << renderers << '\n'
+		  << "Time (s): " << time.count() << '\n'
+		  << "Plots per second: " << rendered / time.count() << '\n';
+	return 0;
+}
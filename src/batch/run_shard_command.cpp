@@ -0,0 +1,159 @@
+/**
+ * @file run_shard_command.cpp
+ * @brief "compton_batch run-shard", runs shards of a job directory, see
+ * ShardManifest.hpp. With --shard n it runs that shard. Otherwise it
+ * claims shards one at a time by creating shard-n.claim with O_EXCL, which
+ * only one process can do even across machines, until none are left.
+ */
+
+#include <BatchCommands.hpp>
+#include <ComptonSweep.hpp>
+#include <ShardManifest.hpp>
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+
+/**
+ * @brief the rows [first, last) of the theta x lambda grid, row
+ * i * theta_steps + j being angle j of wavelength i. Wavelengths the shard
+ * covers whole go through a ComptonSweep, so only the first pays for the
+ * angle terms; the part wavelengths at its ends are evaluated row by row.
+ * Either way the rows are the same as those of the sweep command.
+ */
+static void run_sweep_shard(const ShardManifest &manifest, std::size_t shard,
+			    CheckpointData &data)
+{
+	SweepJob job = sweep_job_from_options(manifest.options);
+	ShardRange range = manifest.shards[shard];
+	uint64_t steps = job.theta_steps;
+
+	std::unique_ptr<ComptonSweep> sweep;
+	for (uint64_t lambda = range.first / steps;
+	     range.first < range.last && lambda * steps < range.last;
+	     ++lambda) {
+		uint64_t first = std::max(range.first, lambda * steps);
+		uint64_t last = std::min(range.last, (lambda + 1) * steps);
+		if (last - first < steps) {
+			for (uint64_t row = first; row < last; ++row)
+				put_result_row(data, compton_evaluate(
+					ComptonSweep::angle(job.theta_min,
+						job.theta_max, steps,
+						row - lambda * steps),
+					job.lambdas[lambda]));
+			continue;
+		}
+
+		if (!sweep)
+			sweep = std::make_unique<ComptonSweep>(job.theta_min,
+				job.theta_max, steps, job.lambdas[lambda]);
+		else
+			sweep->setLambda(job.lambdas[lambda]);
+		for (const ComptonResultValues &r : sweep->getResults())
+			put_result_row(data, r);
+	}
+}
+
+/**
+ * @brief the batches [first, last) of the transport run
+ */
+static void run_transport_shard(const ShardManifest &manifest,
+				std::size_t shard, unsigned threads,
+				CheckpointData &data)
+{
+	SlabSettings settings = slab_settings_from_options(manifest.options);
+	settings.threads = threads;
+	ShardRange range = manifest.shards[shard];
+	run_slab_batches(settings, range.first, range.last).save(data);
+}
+
+/**
+ * @brief runs one shard and writes its output file
+ */
+static void run_shard(const ShardManifest &manifest, std::size_t shard,
+		      unsigned threads)
+{
+	auto start = std::chrono::steady_clock::now();
+	CheckpointData data;
+	data.putU64(manifest.fingerprint());
+	data.putU64(shard);
+	data.putU64(manifest.shards[shard].first);
+	data.putU64(manifest.shards[shard].last);
+
+	if (manifest.job == "sweep") {
+		run_sweep_shard(manifest, shard, data);
+		write_checkpoint(manifest.outputPath(shard),
+				 CHECKPOINT_SWEEP_SHARD, data);
+	} else {
+		run_transport_shard(manifest, shard, threads, data);
+		write_checkpoint(manifest.outputPath(shard),
+				 CHECKPOINT_TRANSPORT_SHARD, data);
+	}
+
+	std::chrono::duration<double> time =
+		std::chrono::steady_clock::now() - start;
+	std::cout << "Shard " << shard << " done in " << time.count()
+		  << " s\n" << std::flush;
+}
+
+/**
+ * @brief claims a shard for this process
+ * @return false if another process already has it
+ */
+static bool claim_shard(const ShardManifest &manifest, std::size_t shard)
+{
+	std::string path = manifest.claimPath(shard);
+	int fd = open(path.c_str(), O_CREAT | O_EXCL | O_WRONLY, 0644);
+	if (fd < 0) {
+		if (errno == EEXIST)
+			return false;
+		throw std::runtime_error("could not create " + path + ": "
+					 + strerror(errno));
+	}
+
+	char host[256] = "";
+	gethostname(host, sizeof(host) - 1);
+	std::string owner = std::string(host) + " "
+		+ std::to_string(getpid()) + "\n";
+	if (write(fd, owner.data(), owner.size()) < 0)
+		std::cerr << "could not write " << path << '\n';
+	close(fd);
+	return true;
+}
+
+int run_shard_command(const BatchOptions &options)
+{
+	ShardManifest manifest = read_shard_manifest(options.get("job-dir",
+								 "."));
+	unsigned threads = options.getNumber("threads", 0);
+
+	if (options.has("shard")) {
+		std::size_t shard = options.getNumber("shard", 0);
+		if (shard >= manifest.shards.size())
+			throw std::invalid_argument("there are only "
+				+ std::to_string(manifest.shards.size())
+				+ " shards");
+		run_shard(manifest, shard, threads);
+		return 0;
+	}
+
+	// a shard whose process died leaves its claim behind, it can be run
+	// again with --shard n or by deleting the claim
+	std::size_t ran = 0;
+	for (std::size_t shard = 0; shard < manifest.shards.size(); ++shard) {
+		if (std::filesystem::exists(manifest.outputPath(shard)) ||
+		    !claim_shard(manifest, shard))
+			continue;
+		run_shard(manifest, shard, threads);
+		ran++;
+	}
+	std::cout << "Ran " << ran << " of " << manifest.shards.size()
+		  << " shards\n";
+	return 0;
+}
@@ -0,0 +1,281 @@
+/**
+ * @file serve_command.cpp
+ * @brief "compton_batch serve", answers (theta, lambda) requests from other
+ * programs over a Unix domain socket, see ComptonProtocol.hpp.
+ *
+ * One thread runs an epoll loop over every connection. All of the requests
+ * read in one pass of the loop, from every client, go through the kernel
+ * as one batch, and the responses are queued on their connections.
+ * A connection stops being read while more than --max-pending bytes of
+ * responses are waiting for it, so a client that sends without reading
+ * gets backpressure instead of growing the server's memory.
+ */
+
+#include <BatchCommands.hpp>
+#include <ComptonKernel.hpp>
+#include <ComptonProtocol.hpp>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <unordered_map>
+
+static volatile sig_atomic_t stop_serving = 0;
+
+static void handle_stop_signal(int)
+{
+	stop_serving = 1;
+}
+
+struct ServerConnection {
+	int fd;
+	std::vector<char> in;      // bytes of a partly received request
+	std::vector<char> out;     // responses not written yet
+	std::size_t out_sent = 0;
+	std::size_t queued = 0;     // requests in the batch, not answered yet
+	uint32_t events = EPOLLIN;  // what epoll watches the fd for
+	bool touched = false;       // has new responses from this batch
+
+	/**
+	 * @brief bytes of responses the client hasn't read yet, written or
+	 * still to be calculated
+	 */
+	std::size_t backlog() const
+	{
+		return out.size() - out_sent + queued * sizeof(ComptonResponse);
+	}
+};
+
+// a request taken from a connection, waiting for the batch to run
+struct QueuedRequest {
+	ServerConnection *connection;
+	uint32_t id;
+};
+
+static void set_nonblocking(int fd)
+{
+	fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+}
+
+/**
+ * @brief writes as much of the connection's output as the socket takes
+ * @return false if the connection failed
+ */
+static bool flush_connection(ServerConnection &c)
+{
+	while (c.out_sent < c.out.size()) {
+		ssize_t n = write(c.fd, c.out.data() + c.out_sent,
+				  c.out.size() - c.out_sent);
+		if (n < 0)
+			return errno == EAGAIN || errno == EWOULDBLOCK;
+		c.out_sent += n;
+	}
+	c.out.clear();
+	c.out_sent = 0;
+	return true;
+}
+
+/**
+ * @brief watches the fd for input only while its backlog is under the cap,
+ * and for output while it has responses to write
+ */
+static void watch_connection(int epoll, ServerConnection &c,
+			     std::size_t max_pending)
+{
+	uint32_t events = (c.backlog() < max_pending ? EPOLLIN : 0) |
+		(c.out.empty() ? 0 : EPOLLOUT);
+	if (events == c.events)
+		return;
+	epoll_event e = {};
+	e.events = events;
+	e.data.ptr = &c;
+	epoll_ctl(epoll, EPOLL_CTL_MOD, c.fd, &e);
+	c.events = events;
+}
+
+/**
+ * @brief reads what is available, until the connection's backlog reaches
+ * max_pending, and queues the complete requests
+ * @return false if the client hung up or the connection failed
+ */
+static bool read_requests(ServerConnection &c,
+			  std::vector<QueuedRequest> &queue,
+			  std::vector<long double> &theta,
+			  std::vector<long double> &lambda,
+			  std::size_t max_pending)
+{
+	char chunk[16384];
+	while (c.backlog() < max_pending) {
+		ssize_t n = read(c.fd, chunk, sizeof(chunk));
+		if (n == 0)
+			return false;
+		if (n < 0)
+			return errno == EAGAIN || errno == EWOULDBLOCK;
+		c.in.insert(c.in.end(), chunk, chunk + n);
+
+		std::size_t used = 0;
+		while (c.in.size() - used >= sizeof(ComptonRequest)) {
+			ComptonRequest request;
+			memcpy(&request, c.in.data() + used, sizeof(request));
+			used += sizeof(request);
+			queue.push_back({&c, request.id});
+			c.queued++;
+			theta.push_back(request.theta);
+			lambda.push_back(request.lambda_naught);
+		}
+		c.in.erase(c.in.begin(), c.in.begin() + used);
+	}
+	return true;
+}
+
+int serve_command(const BatchOptions &options)
+{
+	std::string path = options.get("socket", "/tmp/compton.sock");
+	std::size_t max_pending = options.getNumber("max-pending", 1 << 20);
+	if (max_pending < sizeof(ComptonResponse))
+		throw std::invalid_argument("--max-pending must hold at least "
+					    "one response");
+
+	int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+	sockaddr_un address = {};
+	address.sun_family = AF_UNIX;
+	if (listener < 0 || path.size() >= sizeof(address.sun_path))
+		throw std::runtime_error("could not create socket " + path);
+	strcpy(address.sun_path, path.c_str());
+	unlink(path.c_str());
+	if (bind(listener, (sockaddr *) &address, sizeof(address)) != 0 ||
+	    listen(listener, 128) != 0)
+		throw std::runtime_error("could not listen on " + path + ": "
+					 + strerror(errno));
+	set_nonblocking(listener);
+
+	int epoll = epoll_create1(0);
+	epoll_event event = {};
+	event.events = EPOLLIN;
+	event.data.ptr = nullptr; // the listener
+	epoll_ctl(epoll, EPOLL_CTL_ADD, listener, &event);
+
+	signal(SIGPIPE, SIG_IGN);
+	signal(SIGINT, handle_stop_signal);
+	signal(SIGTERM, handle_stop_signal);
+	std::cout << "Serving on " << path << '\n' << std::flush;
+
+	std::unordered_map<ServerConnection *,
+			   std::unique_ptr<ServerConnection>> connections;
+	std::vector<epoll_event> events(256);
+	std::vector<QueuedRequest> queue;
+	std::vector<long double> theta, lambda;
+	std::vector<ComptonResultValues> results;
+	std::vector<uint32_t> status;
+	ComptonErrorCounts errors;
+	uint64_t requests = 0, batches = 0;
+
+	while (!stop_serving) {
+		int ready = epoll_wait(epoll, events.data(), events.size(), 500);
+		if (ready < 0 && errno != EINTR)
+			throw std::runtime_error(std::string("epoll_wait: ")
+						 + strerror(errno));
+
+		std::vector<ServerConnection *> closed;
+		for (int i = 0; i < ready; ++i) {
+			ServerConnection *c = (ServerConnection *) events[i].data.ptr;
+			if (!c) {
+				int fd;
+				while ((fd = accept(listener, nullptr, nullptr)) >= 0) {
+					set_nonblocking(fd);
+					auto connection = std::make_unique<ServerConnection>();
+					connection->fd = fd;
+					epoll_event e = {};
+					e.events = EPOLLIN;
+					e.data.ptr = connection.get();
+					epoll_ctl(epoll, EPOLL_CTL_ADD, fd, &e);
+					connections[connection.get()] =
+						std::move(connection);
+				}
+				continue;
+			}
+
+			bool ok = true;
+			if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))
+				ok = read_requests(*c, queue, theta, lambda,
+						   max_pending);
+			if (ok && (events[i].events & EPOLLOUT)) {
+				ok = flush_connection(*c);
+				// draining may let it be read again
+				if (ok)
+					watch_connection(epoll, *c, max_pending);
+			}
+			if (!ok)
+				closed.push_back(c);
+		}
+
+		// one kernel call for everything that arrived in this pass,
+		// checking every row as it goes
+		if (!queue.empty()) {
+			results.resize(queue.size());
+			status.resize(queue.size());
+			errors.merge(compton_evaluate_batch_checked(theta.data(),
+				lambda.data(), results.data(), status.data(),
+				queue.size()));
+			std::vector<ServerConnection *> touched;
+			for (std::size_t i = 0; i < queue.size(); ++i) {
+				ServerConnection *c = queue[i].connection;
+				ComptonResponse response;
+				encode_response(response, queue[i].id, status[i],
+						results[i]);
+				const char *bytes = (const char *) &response;
+				c->out.insert(c->out.end(), bytes,
+					      bytes + sizeof(response));
+				c->queued--;
+				if (!c->touched) {
+					c->touched = true;
+					touched.push_back(c);
+				}
+			}
+			requests += queue.size();
+			batches++;
+			queue.clear();
+			theta.clear();
+			lambda.clear();
+
+			for (ServerConnection *t : touched) {
+				ServerConnection &c = *t;
+				c.touched = false;
+				if (!flush_connection(c)) {
+					closed.push_back(&c);
+					continue;
+				}
+				watch_connection(epoll, c, max_pending);
+			}
+		}
+
+		for (ServerConnection *c : closed) {
+			if (!connections.count(c))
+				continue;
+			epoll_ctl(epoll, EPOLL_CTL_DEL, c->fd, nullptr);
+			close(c->fd);
+			connections.erase(c);
+		}
+	}
+
+	for (auto &entry : connections)
+		close(entry.second->fd);
+	close(epoll);
+	close(listener);
+	unlink(path.c_str());
+
+	std::cout << "Requests: " << requests << '\n'
+		  << "Batches: " << batches << '\n';
+	if (batches)
+		std::cout << "Mean batch size: " << (double) requests / batches
+			  << '\n';
+	print_error_counts(errors);
+	return 0;
+}
@@ -0,0 +1,43 @@
+/**
+ * @file shard_plan_command.cpp
+ * @brief "compton_batch shard-plan", splits a sweep or transport job into
+ * shards and writes the manifest, see ShardManifest.hpp
+ */
+
+#include <BatchCommands.hpp>
+#include <ShardManifest.hpp>
+#include <iostream>
+#include <stdexcept>
+
+int shard_plan_command(const BatchOptions &options)
+{
+	ShardManifest manifest;
+	manifest.directory = options.get("job-dir", "");
+	manifest.job = options.get("job", "sweep");
+	std::size_t shards = options.getNumber("shards", 0);
+	if (manifest.directory.empty() || shards == 0)
+		throw std::invalid_argument("--job-dir and --shards are needed");
+
+	// everything else on the command line is an option of the job, except
+	// --threads, which each machine chooses when it runs its shards
+	manifest.options = options;
+	for (const char *key : {"job-dir", "job", "shards", "threads"})
+		manifest.options.values.erase(key);
+
+	uint64_t total;
+	if (manifest.job == "sweep") {
+		total = sweep_job_from_options(manifest.options).rows();
+	} else if (manifest.job == "transport") {
+		total = slab_batch_count(
+			slab_settings_from_options(manifest.options));
+	} else {
+		throw std::invalid_argument("--job must be sweep or transport");
+	}
+	manifest.shards = split_shard_ranges(total, shards);
+	write_shard_manifest(manifest);
+
+	std::cout << "Wrote " << manifest.manifestPath() << ": " << shards
+		  << " shards of " << total
+		  << (manifest.job == "sweep" ? " rows" : " batches") << '\n';
+	return 0;
+}
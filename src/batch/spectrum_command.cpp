@@ -0,0 +1,45 @@
+/**
+ * @file spectrum_command.cpp
+ * @brief "compton_batch spectrum", scatters an incident spectrum file at one
+ * angle or over all angles and writes the photon and electron spectra
+ */
+
+#include <BatchCommands.hpp>
+#include <ComptonSpectrum.hpp>
+#include <chrono>
+#include <iostream>
+#include <stdexcept>
+
+int spectrum_command(const BatchOptions &options)
+{
+	if (!options.has("input"))
+		throw std::invalid_argument("--input is required");
+
+	auto start = std::chrono::steady_clock::now();
+	std::vector<SpectrumPoint> points = load_spectrum(options.get("input", ""));
+	BinnedSpectrum incident =
+		bin_spectrum(points, (std::size_t) options.getNumber("bins", 2048));
+
+	ScatteredSpectrum scattered;
+	if (options.has("all-angles"))
+		scattered = scatter_spectrum_all_angles(incident,
+			(std::size_t) options.getNumber("theta-steps", 180));
+	else
+		scattered = scatter_spectrum(incident,
+					     options.getNumber("theta", 30));
+
+	write_spectrum(scattered.photon,
+		       options.get("photon-out", "scattered_photons.txt"));
+	write_spectrum(scattered.electron,
+		       options.get("electron-out", "recoil_electrons.txt"));
+
+	std::chrono::duration<double> elapsed =
+		std::chrono::steady_clock::now() - start;
+	std::cout << "Incident intensity: " << incident.total() << '\n'
+		  << "Scattered photon intensity: " << scattered.photon.total()
+		  << '\n'
+		  << "Recoil electron intensity: " << scattered.electron.total()
+		  << '\n'
+		  << "Time (s): " << elapsed.count() << '\n';
+	return 0;
+}
@@ -0,0 +1,265 @@
+/**
+ * @file sweep_command.cpp
+ * @brief "compton_batch sweep", the results over a range of angles for one
+ * or more incident wavelengths, reusing the angle terms between wavelengths
+ */
+
+#include <BatchCommands.hpp>
+#include <Checkpoint.hpp>
+#include <ComptonSweep.hpp>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+
+/**
+ * @brief splits a comma separated list of numbers
+ */
+std::vector<long double> parse_number_list(const std::string &list)
+{
+	std::vector<long double> numbers;
+	std::istringstream in(list);
+	std::string item;
+	while (std::getline(in, item, ','))
+		if (!item.empty())
+			numbers.push_back(std::stold(item));
+	return numbers;
+}
+
+/**
+ * @brief reads --theta-min, --theta-max, --theta-steps and --lambda
+ */
+SweepJob sweep_job_from_options(const BatchOptions &options)
+{
+	SweepJob job;
+	job.theta_min = options.getNumber("theta-min", 0);
+	job.theta_max = options.getNumber("theta-max", 180);
+	job.theta_steps = options.getNumber("theta-steps", 181);
+	job.lambdas = parse_number_list(options.get("lambda", "10"));
+	if (job.lambdas.empty())
+		throw std::invalid_argument("--lambda needs at least one value");
+	return job;
+}
+
+/**
+ * @brief writes the comment line naming the columns of write_result_rows
+ */
+void write_result_header(std::ostream &out)
+{
+	out << "# theta lambda_naught lambda_prime photon_energy_naught "
+		"photon_energy_prime photon_momentum_naught "
+		"photon_momentum_prime electron_energy electron_velocity "
+		"electron_momentum electron_scatter_angle\n";
+}
+
+/**
+ * @brief writes result rows as whitespace separated columns in the order of
+ * ComptonResultValues
+ */
+void write_result_rows(std::ostream &out,
+		       const std::vector<ComptonResultValues> &rows)
+{
+	write_result_rows(out, rows.data(), rows.size());
+}
+
+void write_result_rows(std::ostream &out, const ComptonResultValues *rows,
+		       std::size_t n)
+{
+	out.precision(10);
+	for (std::size_t i = 0; i < n; ++i) {
+		const ComptonResultValues &r = rows[i];
+		out << r.theta << ' ' << r.lambda_naught << ' '
+		    << r.lambda_prime << ' ' << r.photon_energy_naught << ' '
+		    << r.photon_energy_prime << ' '
+		    << r.photon_momentum_naught << ' '
+		    << r.photon_momentum_prime << ' ' << r.electron_energy << ' '
+		    << r.electron_velocity << ' ' << r.electron_momentum << ' '
+		    << r.electron_scatter_angle << '\n';
+	}
+}
+
+/**
+ * @brief prints how many rows had errors, and which, see compton_status()
+ */
+void print_error_counts(const ComptonErrorCounts &counts)
+{
+	std::cout << "Rows with errors: " << counts.rows << '\n';
+	for (int b = 0; b < COMPTON_STATUS_BITS; ++b)
+		if (counts.bits[b])
+			std::cout << "  " << counts.bits[b] << ": "
+				  << compton_status_name(b) << '\n';
+}
+
+/**
+ * @brief hashes the sweep settings written as exact hexadecimal floats
+ */
+static uint64_t sweep_fingerprint(long double theta_min, long double theta_max,
+				  std::size_t steps,
+				  const std::vector<long double> &lambdas)
+{
+	std::ostringstream text;
+	text << std::hexfloat << theta_min << ' ' << theta_max << ' ' << steps;
+	for (long double lambda : lambdas)
+		text << ' ' << lambda;
+	std::string s = text.str();
+	return fnv1a_hash(s.data(), s.size());
+}
+
+// rows written between chances to checkpoint
+static const std::size_t SWEEP_WRITE_BLOCK = 4096;
+
+int sweep_command(const BatchOptions &options)
+{
+	SweepJob job = sweep_job_from_options(options);
+	const std::vector<long double> &lambdas = job.lambdas;
+	long double theta_min = job.theta_min;
+	long double theta_max = job.theta_max;
+	std::size_t steps = job.theta_steps;
+
+	// with --checkpoint, the checkpoint holds the index of the next
+	// wavelength, the next row of it, how much of the output file was
+	// written before that row and the error counts of the rows before it
+	std::string checkpoint = options.get("checkpoint", "");
+	uint64_t fingerprint = sweep_fingerprint(theta_min, theta_max, steps,
+						 lambdas);
+	if (!checkpoint.empty() && !options.has("out"))
+		throw std::invalid_argument("--checkpoint needs --out");
+	if (!checkpoint.empty() && options.has("archive"))
+		throw std::invalid_argument("--archive can't be checkpointed, "
+					    "split the sweep into shards instead");
+	std::size_t first = 0;
+	std::size_t first_row = 0;
+	uint64_t offset = 0;
+	ComptonErrorCounts errors;
+	if (options.has("resume")) {
+		CheckpointData data = read_checkpoint(checkpoint,
+						      CHECKPOINT_SWEEP);
+		if (data.getU64() != fingerprint)
+			throw std::runtime_error(checkpoint + " was written with "
+						 "other settings");
+		first = data.getU64();
+		first_row = data.getU64();
+		offset = data.getU64();
+		errors.rows = data.getU64();
+		for (int b = 0; b < COMPTON_STATUS_BITS; ++b)
+			errors.bits[b] = data.getU64();
+		std::cout << "Resuming at wavelength " << first << " of "
+			  << lambdas.size() << ", row " << first_row << '\n';
+	}
+	bool resuming = first > 0 || first_row > 0;
+
+	std::ofstream out;
+	if (options.has("out")) {
+		std::string path = options.get("out", "");
+		if (resuming) {
+			// drop anything written after the checkpoint
+			std::filesystem::resize_file(path, offset);
+			out.open(path, std::ios::app);
+		} else {
+			out.open(path);
+		}
+		if (!out)
+			throw std::runtime_error("could not write " + path);
+		if (!resuming)
+			write_result_header(out);
+	}
+
+	std::unique_ptr<ResultArchiveWriter> archive;
+	if (options.has("archive"))
+		archive = std::make_unique<ResultArchiveWriter>(
+			options.get("archive", ""),
+			archive_settings_from_options(options));
+
+	std::unique_ptr<CheckpointWriter> writer;
+	if (!checkpoint.empty())
+		writer = std::make_unique<CheckpointWriter>(checkpoint);
+	double interval = options.getNumber("checkpoint-interval", 60);
+	std::chrono::duration<double> saving{0};
+	auto last_checkpoint = std::chrono::steady_clock::now();
+	auto save = [&](std::size_t next, std::size_t next_row) {
+		auto begin = std::chrono::steady_clock::now();
+		out.flush();
+		CheckpointData data;
+		data.putU64(fingerprint);
+		data.putU64(next);
+		data.putU64(next_row);
+		data.putU64(out.tellp());
+		data.putU64(errors.rows);
+		for (int b = 0; b < COMPTON_STATUS_BITS; ++b)
+			data.putU64(errors.bits[b]);
+		writer->submit(CHECKPOINT_SWEEP, std::move(data));
+		last_checkpoint = std::chrono::steady_clock::now();
+		saving += last_checkpoint - begin;
+	};
+
+	if (first >= lambdas.size()) {
+		std::cout << "Nothing left to do\n";
+		return 0;
+	}
+
+	// the rows of a wavelength go out a block at a time, with a chance to
+	// checkpoint before each block, so one huge wavelength still gets
+	// checkpoints. Each block's rows are counted in the errors as it is
+	// written, so a checkpoint holds the counts of the rows before it.
+	auto write_rows = [&](const ComptonSweep &sweep, std::size_t i,
+			      std::size_t row) {
+		const std::vector<uint32_t> &status = sweep.getStatus();
+		for (; row < sweep.size(); row += SWEEP_WRITE_BLOCK) {
+			std::chrono::duration<double> since =
+				std::chrono::steady_clock::now() - last_checkpoint;
+			if (writer && since.count() >= interval)
+				save(i, row);
+
+			std::size_t rows = std::min(sweep.size() - row,
+						    SWEEP_WRITE_BLOCK);
+			uint64_t by_status[1 << COMPTON_STATUS_BITS] = {0};
+			for (std::size_t r = row; r < row + rows; ++r)
+				by_status[status[r]]++;
+			errors.addHistogram(by_status);
+			if (out)
+				write_result_rows(out, &sweep[row], rows);
+			if (archive)
+				archive->write(&sweep[row], rows);
+		}
+	};
+
+	auto start = std::chrono::steady_clock::now();
+	ComptonSweep sweep(theta_min, theta_max, steps, lambdas[first]);
+	std::chrono::duration<double> full =
+		std::chrono::steady_clock::now() - start;
+	write_rows(sweep, first, first_row);
+
+	// every later wavelength only updates the lambda dependent terms
+	std::chrono::duration<double> incremental{0};
+	for (std::size_t i = first + 1; i < lambdas.size(); ++i) {
+		start = std::chrono::steady_clock::now();
+		sweep.setLambda(lambdas[i]);
+		incremental += std::chrono::steady_clock::now() - start;
+		write_rows(sweep, i, 0);
+	}
+
+	std::cout << "Angles: " << sweep.size() << '\n'
+		  << "Full sweep (s): " << full.count() << '\n';
+	if (lambdas.size() - first > 1)
+		std::cout << "Mean wavelength update (s): "
+			  << incremental.count() / (lambdas.size() - first - 1)
+			  << '\n';
+	print_error_counts(errors);
+	if (archive) {
+		archive->close();
+		print_archive_size(archive->rowsWritten(),
+				   archive->bytesWritten());
+	}
+	if (writer) {
+		save(lambdas.size(), 0);
+		writer->wait();
+		std::cout << "Checkpoint time on the run thread (s): "
+			  << saving.count() << '\n'
+			  << "Checkpoint write time in the background (s): "
+			  << writer->writeSeconds() << '\n';
+	}
+	return 0;
+}
@@ -0,0 +1,208 @@
+/**
+ * @file transport_command.cpp
+ * @brief "compton_batch transport", Monte Carlo photon histories through a
+ * slab, see SlabTransport.hpp
+ */
+
+#include <BatchCommands.hpp>
+#include <SlabTransport.hpp>
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+
+/**
+ * @brief reads the slab settings shared by the transport commands
+ */
+SlabSettings slab_settings_from_options(const BatchOptions &options)
+{
+	SlabSettings settings;
+	settings.lambda_naught = options.getNumber("lambda",
+						   settings.lambda_naught);
+	settings.thickness = options.getNumber("thickness", settings.thickness);
+	settings.electron_density = options.getNumber("density",
+						      settings.electron_density);
+	settings.absorption = options.getNumber("absorption",
+						settings.absorption);
+	settings.max_scatters = (unsigned) options.getNumber("max-scatters",
+		settings.max_scatters);
+	settings.histories = (uint64_t) options.getNumber("histories",
+		settings.histories);
+	settings.seed = (uint64_t) options.getNumber("seed", settings.seed);
+	settings.threads = (unsigned) options.getNumber("threads",
+							settings.threads);
+	settings.spectrum_bins = (std::size_t) options.getNumber("bins",
+		settings.spectrum_bins);
+	settings.spectrum_range = options.getNumber("range",
+						    settings.spectrum_range);
+
+	if (settings.lambda_naught <= 0 || settings.thickness <= 0 ||
+	    settings.spectrum_bins == 0)
+		throw std::invalid_argument("lambda, thickness and bins must be "
+					    "positive");
+	return settings;
+}
+
+/**
+ * @brief writes one exit spectrum as (wavelength shift in pm, count) rows
+ */
+void write_exit_spectrum(const std::vector<uint64_t> &spectrum,
+			 const SlabSettings &settings, const std::string &path)
+{
+	std::ofstream out(path);
+	if (!out)
+		throw std::runtime_error("could not write " + path);
+
+	long double width = settings.spectrum_range / spectrum.size();
+	for (std::size_t i = 0; i < spectrum.size(); ++i)
+		out << (i + 0.5L) * width << ' ' << spectrum[i] << '\n';
+}
+
+/**
+ * @brief prints the counters of a finished run
+ */
+void print_slab_tally(const SlabTally &tally)
+{
+	long double n = tally.histories;
+	std::cout << "Histories: " << tally.histories << '\n'
+		  << "Transmitted: " << tally.transmitted / n << '\n'
+		  << "Transmitted without scattering: "
+		  << tally.transmitted_unscattered / n << '\n'
+		  << "Reflected: " << tally.reflected / n << '\n'
+		  << "Absorbed: " << tally.absorbed / n << '\n'
+		  << "Mean scatters per photon: " << tally.scatters / n << '\n'
+		  << "Deposited energy per photon (eV): "
+		  << tally.deposited_energy / n / 1000 << '\n';
+}
+
+static volatile sig_atomic_t stop_transport = 0;
+
+static void handle_stop_signal(int)
+{
+	stop_transport = 1;
+}
+
+/**
+ * @brief runs the histories in rounds of batches, and after any round
+ * that ends checkpoint-interval seconds after the last checkpoint, hands
+ * the merged tally and the next batch index to the checkpoint writer.
+ * Batch streams depend only on the seed and the batch index, so that is
+ * all of the random number state there is between rounds. SIGINT and
+ * SIGTERM stop the run at the end of the current round with a checkpoint.
+ * @param resumed set to the number of histories in the checkpoint resumed
+ * from
+ * @return false if the run was stopped before the last batch
+ */
+static bool run_with_checkpoints(const SlabSettings &settings,
+				 const BatchOptions &options, SlabTally &tally,
+				 uint64_t &resumed)
+{
+	std::string path = options.get("checkpoint", "");
+	double interval = options.getNumber("checkpoint-interval", 60);
+	uint64_t fingerprint = slab_settings_fingerprint(settings);
+	uint64_t batches = slab_batch_count(settings);
+	uint64_t next = 0;
+
+	if (options.has("resume")) {
+		CheckpointData data = read_checkpoint(path,
+						      CHECKPOINT_TRANSPORT);
+		if (data.getU64() != fingerprint)
+			throw std::runtime_error(path + " was written with "
+						 "other settings");
+		next = data.getU64();
+		tally.load(data);
+		resumed = tally.histories;
+		std::cout << "Resuming at batch " << next << " of " << batches
+			  << '\n';
+	}
+
+	unsigned threads = settings.threads;
+	if (threads == 0)
+		threads = std::max(1u, std::thread::hardware_concurrency());
+	uint64_t round = 8 * threads;
+
+	signal(SIGINT, handle_stop_signal);
+	signal(SIGTERM, handle_stop_signal);
+
+	CheckpointWriter writer(path);
+	auto start = std::chrono::steady_clock::now();
+	auto last = start;
+	std::chrono::duration<double> saving{0};
+	uint64_t saved = 0;
+	auto save = [&]() {
+		auto begin = std::chrono::steady_clock::now();
+		CheckpointData data;
+		data.putU64(fingerprint);
+		data.putU64(next);
+		tally.save(data);
+		writer.submit(CHECKPOINT_TRANSPORT, std::move(data));
+		last = std::chrono::steady_clock::now();
+		saving += last - begin;
+		saved++;
+	};
+
+	while (next < batches && !stop_transport) {
+		uint64_t end = std::min(batches, next + round);
+		tally.merge(run_slab_batches(settings, next, end));
+		next = end;
+		std::chrono::duration<double> since =
+			std::chrono::steady_clock::now() - last;
+		if (since.count() >= interval && next < batches)
+			save();
+	}
+	save();
+	writer.wait();
+
+	std::chrono::duration<double> run =
+		std::chrono::steady_clock::now() - start;
+	std::cout << "Checkpoints: " << saved << '\n'
+		  << "Checkpoint time on the run thread (s): " << saving.count()
+		  << " (" << 100 * saving.count() / run.count() << "% of "
+		  << run.count() << " s)\n"
+		  << "Checkpoint write time in the background (s): "
+		  << writer.writeSeconds() << '\n';
+
+	signal(SIGINT, SIG_DFL);
+	signal(SIGTERM, SIG_DFL);
+	if (next < batches) {
+		std::cout << "Stopped at batch " << next << " of " << batches
+			  << ", continue with --resume\n";
+		return false;
+	}
+	return true;
+}
+
+int transport_command(const BatchOptions &options)
+{
+	SlabSettings settings = slab_settings_from_options(options);
+	if (options.has("resume") && !options.has("checkpoint"))
+		throw std::invalid_argument("--resume needs --checkpoint");
+
+	auto start = std::chrono::steady_clock::now();
+	SlabTally tally(settings);
+	uint64_t resumed = 0;
+	if (options.has("checkpoint")) {
+		if (!run_with_checkpoints(settings, options, tally, resumed))
+			return 3;
+	} else {
+		tally = run_slab_transport(settings);
+	}
+	std::chrono::duration<double> elapsed =
+		std::chrono::steady_clock::now() - start;
+
+	print_slab_tally(tally);
+	std::cout << "Time (s): " << elapsed.count() << '\n'
+		  << "Histories per second: "
+		  << (tally.histories - resumed) / elapsed.count() << '\n';
+
+	if (options.has("transmitted-out"))
+		write_exit_spectrum(tally.transmitted_spectrum, settings,
+				    options.get("transmitted-out", ""));
+	if (options.has("reflected-out"))
+		write_exit_spectrum(tally.reflected_spectrum, settings,
+				    options.get("reflected-out", ""));
+	return 0;
+}
@@ -0,0 +1,125 @@
+/**
+ * @file unpack_command.cpp
+ * @brief "compton_batch unpack", decompresses a result archive written by
+ * sweep or merge with --archive (see ResultArchive.hpp) back to text, and
+ * the --precision, --error and --keep-derived options those commands use
+ * to write one.
+ */
+
+#include <BatchCommands.hpp>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+/**
+ * @brief applies a per column option, either one value for every column
+ * or "column=value,column=value"
+ */
+template <typename Apply>
+static void for_columns(const std::string &list, Apply apply)
+{
+	if (list.find('=') == std::string::npos) {
+		for (std::size_t c = 0; c < RESULT_COLUMNS; ++c)
+			apply(c, list);
+		return;
+	}
+	std::istringstream in(list);
+	std::string item;
+	while (std::getline(in, item, ',')) {
+		std::size_t equals = item.find('=');
+		if (equals == std::string::npos)
+			throw std::invalid_argument("expected column=value, not "
+						    + item);
+		apply(result_column_index(item.substr(0, equals)),
+		      item.substr(equals + 1));
+	}
+}
+
+static ColumnPrecision parse_precision(const std::string &name)
+{
+	if (name == "long-double")
+		return ColumnPrecision::LONG_DOUBLE;
+	if (name == "double")
+		return ColumnPrecision::DOUBLE;
+	if (name == "float")
+		return ColumnPrecision::FLOAT;
+	throw std::invalid_argument("--precision must be long-double, double "
+				    "or float, not " + name);
+}
+
+/**
+ * @brief reads --precision, --error, --keep-derived, --chunk-rows and
+ * --threads
+ */
+ArchiveSettings archive_settings_from_options(const BatchOptions &options)
+{
+	ArchiveSettings settings;
+	for_columns(options.get("precision", "long-double"),
+		    [&](std::size_t c, const std::string &value) {
+			    settings.columns[c].precision =
+				    parse_precision(value);
+		    });
+	for_columns(options.get("error", "0"),
+		    [&](std::size_t c, const std::string &value) {
+			    long double error = std::stold(value);
+			    if (!(error >= 0 && error < 1))
+				    throw std::invalid_argument("--error must be "
+					    "at least 0 and less than 1");
+			    settings.columns[c].error = error;
+		    });
+	for_columns(options.has("keep-derived") ? "0" : "1",
+		    [&](std::size_t c, const std::string &value) {
+			    settings.columns[c].derive = value == "1";
+		    });
+	settings.chunk_rows = options.getNumber("chunk-rows",
+						settings.chunk_rows);
+	settings.threads = options.getNumber("threads", 0);
+	return settings;
+}
+
+/**
+ * @brief prints the size of a finished archive next to the raw rows
+ */
+void print_archive_size(uint64_t rows, uint64_t bytes)
+{
+	std::cout << "Archive bytes: " << bytes << '\n';
+	if (rows > 0)
+		std::cout << "Archive bytes per row: " << (double) bytes / rows
+			  << '\n'
+			  << "Smaller than raw rows by: "
+			  << (double) rows * sizeof(ComptonResultValues) / bytes
+			  << "x\n";
+}
+
+int unpack_command(const BatchOptions &options)
+{
+	if (!options.has("in"))
+		throw std::invalid_argument("unpack needs --in archive");
+	ResultArchiveReader archive(options.get("in", ""));
+
+	auto start = std::chrono::steady_clock::now();
+	std::vector<ComptonResultValues> rows =
+		archive.readAll(options.getNumber("threads", 0));
+	std::chrono::duration<double> time =
+		std::chrono::steady_clock::now() - start;
+
+	if (options.has("out")) {
+		std::ofstream out(options.get("out", ""));
+		if (!out)
+			throw std::runtime_error("could not write "
+						 + options.get("out", ""));
+		write_result_header(out);
+		write_result_rows(out, rows);
+	}
+
+	std::cout << "Rows: " << rows.size() << '\n'
+		  << "Chunks: " << archive.chunks() << '\n';
+	print_archive_size(rows.size(), archive.bytes());
+	std::cout << "Decompressed in (s): " << time.count() << '\n';
+	if (time.count() > 0)
+		std::cout << "Rows per second: " << rows.size() / time.count()
+			  << '\n';
+	return 0;
+}
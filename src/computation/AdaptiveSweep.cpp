@@ -0,0 +1,212 @@
+/**
+ * @file AdaptiveSweep.cpp
+ * @brief Adaptive theta sweeps, see AdaptiveSweep.hpp
+ */
+
+#include <AdaptiveSweep.hpp>
+#include <ComptonKernel.hpp>
+#include <algorithm>
+#include <stdexcept>
+#include <thread>
+
+// the columns that change with theta (lambda_prime, photon_energy_prime,
+// photon_momentum_prime, electron_energy, electron_velocity,
+// electron_momentum, electron_scatter_angle)
+static const int varying_columns[] = {2, 4, 6, 7, 8, 9, 10};
+static const int COLUMNS = 11;
+
+// passes smaller than this aren't worth starting threads for
+static const std::size_t PARALLEL_MINIMUM = 4096;
+
+long double result_column(const ComptonResultValues &r, int column)
+{
+	switch (column) {
+	case 0: return r.theta;
+	case 1: return r.lambda_naught;
+	case 2: return r.lambda_prime;
+	case 3: return r.photon_energy_naught;
+	case 4: return r.photon_energy_prime;
+	case 5: return r.photon_momentum_naught;
+	case 6: return r.photon_momentum_prime;
+	case 7: return r.electron_energy;
+	case 8: return r.electron_velocity;
+	case 9: return r.electron_momentum;
+	case 10: return r.electron_scatter_angle;
+	}
+	throw std::out_of_range("no result column " + std::to_string(column));
+}
+
+/**
+ * @brief evaluates every angle, in contiguous chunks on up to threads
+ * threads
+ */
+static std::vector<ComptonResultValues>
+evaluate_angles(const std::vector<long double> &theta,
+		long double lambda_naught, unsigned threads)
+{
+	std::vector<ComptonResultValues> rows(theta.size());
+	auto evaluate = [&](std::size_t first, std::size_t last) {
+		for (std::size_t i = first; i < last; ++i)
+			rows[i] = compton_evaluate(theta[i], lambda_naught);
+	};
+
+	if (threads <= 1 || theta.size() < PARALLEL_MINIMUM) {
+		evaluate(0, theta.size());
+		return rows;
+	}
+	std::vector<std::thread> pool;
+	std::size_t chunk = (theta.size() + threads - 1) / threads;
+	for (std::size_t first = 0; first < theta.size(); first += chunk)
+		pool.emplace_back(evaluate, first,
+				  std::min(theta.size(), first + chunk));
+	for (std::thread &t : pool)
+		t.join();
+	return rows;
+}
+
+/**
+ * @brief whether b is further than tolerance (as a fraction of the column's
+ * range) from the straight line between its neighbours a and c. A triple
+ * where some but not all of the values are finite fails, so the edge of the
+ * valid region is found to min_spacing, unless the only value that isn't
+ * finite is at an end of the range: that is an isolated point such as the
+ * 0/0 of phi at theta = 0, not an edge, and the column is skipped.
+ * @param a_at_end a is the first row of the range
+ * @param c_at_end c is the last row of the range
+ */
+static bool needs_refinement(const ComptonResultValues &a,
+			     const ComptonResultValues &b,
+			     const ComptonResultValues &c,
+			     bool a_at_end, bool c_at_end,
+			     const long double *scale, long double tolerance)
+{
+	long double t = (b.theta - a.theta) / (c.theta - a.theta);
+	for (int column : varying_columns) {
+		if (scale[column] <= 0)
+			continue;
+		long double va = result_column(a, column);
+		long double vb = result_column(b, column);
+		long double vc = result_column(c, column);
+		int finite = std::isfinite(va) + std::isfinite(vb)
+			+ std::isfinite(vc);
+		if (finite == 0)
+			continue;
+		if (finite == 2 && ((a_at_end && !std::isfinite(va)) ||
+				    (c_at_end && !std::isfinite(vc))))
+			continue;
+		if (finite < 3)
+			return true;
+		if (fabsl(vb - (va * (1 - t) + vc * t)) > tolerance * scale[column])
+			return true;
+	}
+	return false;
+}
+
+AdaptiveCurve adaptive_sweep(long double lambda_naught,
+			     const AdaptiveSettings &settings)
+{
+	if (settings.initial_steps < 2 ||
+	    !(settings.theta_max > settings.theta_min))
+		throw std::invalid_argument("an adaptive sweep needs at least 2 "
+					    "initial steps and theta_max > "
+					    "theta_min");
+	unsigned threads = settings.threads;
+	if (threads == 0)
+		threads = std::max(1u, std::thread::hardware_concurrency());
+
+	AdaptiveCurve curve;
+	curve.lambda_naught = lambda_naught;
+
+	std::vector<long double> theta(settings.initial_steps);
+	long double step = (settings.theta_max - settings.theta_min)
+		/ (settings.initial_steps - 1);
+	for (std::size_t i = 0; i < theta.size(); ++i)
+		theta[i] = settings.theta_min + i * step;
+	theta.back() = settings.theta_max;
+	curve.rows = evaluate_angles(theta, lambda_naught, threads);
+	curve.evaluations = curve.rows.size();
+
+	// the tolerance is relative to how far each column moves over the
+	// range, measured on the starting grid
+	long double scale[COLUMNS] = {};
+	for (int column : varying_columns) {
+		long double low = INFINITY, high = -INFINITY;
+		for (const ComptonResultValues &r : curve.rows) {
+			long double v = result_column(r, column);
+			if (std::isfinite(v)) {
+				low = std::min(low, v);
+				high = std::max(high, v);
+			}
+		}
+		scale[column] = high > low ? high - low : 0;
+	}
+
+	// active[i] is set while the interval between rows i and i + 1 still
+	// needs a midpoint. Every interval of the starting grid gets one.
+	std::vector<char> active(curve.rows.size() - 1, 1);
+	for (;;) {
+		std::vector<long double> midpoints;
+		std::vector<std::size_t> intervals;
+		for (std::size_t i = 0; i < active.size(); ++i) {
+			long double a = curve.rows[i].theta;
+			long double b = curve.rows[i + 1].theta;
+			if (active[i] && (b - a) / 2 >= settings.min_spacing) {
+				midpoints.push_back(a + (b - a) / 2);
+				intervals.push_back(i);
+			}
+		}
+		if (midpoints.empty() ||
+		    curve.rows.size() + midpoints.size() > settings.max_points)
+			break;
+
+		std::vector<ComptonResultValues> evaluated =
+			evaluate_angles(midpoints, lambda_naught, threads);
+		curve.evaluations += evaluated.size();
+		curve.passes++;
+
+		std::vector<ComptonResultValues> rows;
+		rows.reserve(curve.rows.size() + evaluated.size());
+		for (std::size_t i = 0, k = 0; i < curve.rows.size(); ++i) {
+			rows.push_back(curve.rows[i]);
+			if (k < intervals.size() && intervals[k] == i)
+				rows.push_back(evaluated[k++]);
+		}
+		curve.rows.swap(rows);
+
+		// every point is checked against its neighbours, not only the
+		// new midpoints against their old interval, so a feature that
+		// fell between two points that looked converged is still found.
+		// Both intervals beside a failing point are split next pass.
+		active.assign(curve.rows.size() - 1, 0);
+		for (std::size_t i = 1; i + 1 < curve.rows.size(); ++i)
+			if (needs_refinement(curve.rows[i - 1], curve.rows[i],
+					     curve.rows[i + 1], i == 1,
+					     i + 2 == curve.rows.size(), scale,
+					     settings.tolerance))
+				active[i - 1] = active[i] = 1;
+	}
+	return curve;
+}
+
+long double interpolate_curve(const AdaptiveCurve &curve, int column,
+			      long double theta)
+{
+	const std::vector<ComptonResultValues> &rows = curve.rows;
+	if (rows.empty())
+		throw std::invalid_argument("cannot interpolate an empty curve");
+
+	auto after = std::lower_bound(rows.begin(), rows.end(), theta,
+		[](const ComptonResultValues &r, long double t) {
+			return r.theta < t;
+		});
+	if (after == rows.begin())
+		return result_column(rows.front(), column);
+	if (after == rows.end())
+		return result_column(rows.back(), column);
+
+	const ComptonResultValues &a = *(after - 1);
+	const ComptonResultValues &b = *after;
+	long double t = (theta - a.theta) / (b.theta - a.theta);
+	return result_column(a, column) * (1 - t)
+		+ result_column(b, column) * t;
+}
@@ -0,0 +1,312 @@
+/**
+ * @file Checkpoint.cpp
+ * @brief Checkpoint file reading and writing, see Checkpoint.hpp
+ */
+
+#include <Checkpoint.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+#include <unistd.h>
+
+static const char CHECKPOINT_MAGIC[8] = {'C', 'O', 'M', 'P', 'T', 'C', 'K', 'P'};
+
+struct CheckpointHeader {
+	char magic[8];
+	uint32_t version;
+	uint32_t kind;
+	uint64_t length;
+	uint64_t checksum;
+};
+
+uint64_t fnv1a_hash(const void *data, std::size_t length, uint64_t hash)
+{
+	const unsigned char *bytes = (const unsigned char *) data;
+	for (std::size_t i = 0; i < length; ++i) {
+		hash ^= bytes[i];
+		hash *= 0x100000001B3ULL;
+	}
+	return hash;
+}
+
+void CheckpointData::putU64(uint64_t value)
+{
+	const char *p = (const char *) &value;
+	bytes.insert(bytes.end(), p, p + sizeof(value));
+}
+
+void CheckpointData::putU64s(const std::vector<uint64_t> &values)
+{
+	putU64(values.size());
+	const char *p = (const char *) values.data();
+	bytes.insert(bytes.end(), p, p + values.size() * sizeof(uint64_t));
+}
+
+// an x87 long double is these bytes in memory, the rest of its sizeof is
+// padding
+static const bool NATIVE_EXTENDED =
+	std::numeric_limits<long double>::digits == 64 &&
+	std::numeric_limits<long double>::max_exponent == 16384 &&
+	sizeof(long double) >= 10;
+static const int EXTENDED_BIAS = 16383;
+
+ExtendedBits to_extended_bits(long double value)
+{
+	ExtendedBits bits;
+	if constexpr (NATIVE_EXTENDED) {
+		memcpy(&bits.mantissa, &value, sizeof(bits.mantissa));
+		memcpy(&bits.sign_exponent,
+		       (const char *) &value + sizeof(bits.mantissa),
+		       sizeof(bits.sign_exponent));
+		return bits;
+	}
+
+	uint16_t sign = std::signbit(value) ? 0x8000 : 0;
+	if (std::isnan(value))
+		return {0xC000000000000000ULL, (uint16_t) (sign | 0x7FFF)};
+	if (std::isinf(value))
+		return {0x8000000000000000ULL, (uint16_t) (sign | 0x7FFF)};
+	if (value == 0)
+		return {0, sign};
+
+	// |value| = fraction * 2^exponent with fraction in [0.5, 1)
+	int exponent;
+	long double fraction = frexpl(fabsl(value), &exponent);
+	int biased = exponent - 1 + EXTENDED_BIAS;
+	if (biased > 0) {
+		bits.mantissa = (uint64_t) ldexpl(fraction, 64);
+		bits.sign_exponent = sign | biased;
+	} else {
+		// denormal, the mantissa counts units of 2^(1 - bias - 63)
+		bits.mantissa = (uint64_t) ldexpl(fraction, exponent +
+						  EXTENDED_BIAS + 62);
+		bits.sign_exponent = sign;
+	}
+	return bits;
+}
+
+long double from_extended_bits(ExtendedBits bits)
+{
+	if constexpr (NATIVE_EXTENDED) {
+		long double value = 0;
+		memcpy(&value, &bits.mantissa, sizeof(bits.mantissa));
+		memcpy((char *) &value + sizeof(bits.mantissa),
+		       &bits.sign_exponent, sizeof(bits.sign_exponent));
+		return value;
+	}
+
+	int exponent = bits.sign_exponent & 0x7FFF;
+	long double value;
+	if (exponent == 0x7FFF)
+		value = bits.mantissa << 1
+			? std::numeric_limits<long double>::quiet_NaN()
+			: std::numeric_limits<long double>::infinity();
+	else
+		value = ldexpl((long double) bits.mantissa,
+			       std::max(exponent, 1) - EXTENDED_BIAS - 63);
+	return bits.sign_exponent & 0x8000 ? -value : value;
+}
+
+// long doubles take the 10 bytes of the x87 format in the payload
+static const std::size_t LONG_DOUBLE_BYTES = 10;
+
+void CheckpointData::putLongDouble(long double value)
+{
+	ExtendedBits bits = to_extended_bits(value);
+	const char *p = (const char *) &bits.mantissa;
+	bytes.insert(bytes.end(), p, p + sizeof(bits.mantissa));
+	p = (const char *) &bits.sign_exponent;
+	bytes.insert(bytes.end(), p, p + sizeof(bits.sign_exponent));
+}
+
+uint64_t CheckpointData::getU64()
+{
+	uint64_t value;
+	if (bytes.size() - position < sizeof(value))
+		throw std::runtime_error("checkpoint is shorter than expected");
+	memcpy(&value, bytes.data() + position, sizeof(value));
+	position += sizeof(value);
+	return value;
+}
+
+std::vector<uint64_t> CheckpointData::getU64s()
+{
+	uint64_t count = getU64();
+	if ((bytes.size() - position) / sizeof(uint64_t) < count)
+		throw std::runtime_error("checkpoint is shorter than expected");
+	std::vector<uint64_t> values(count);
+	memcpy(values.data(), bytes.data() + position,
+	       count * sizeof(uint64_t));
+	position += count * sizeof(uint64_t);
+	return values;
+}
+
+long double CheckpointData::getLongDouble()
+{
+	ExtendedBits bits;
+	if (bytes.size() - position < LONG_DOUBLE_BYTES)
+		throw std::runtime_error("checkpoint is shorter than expected");
+	memcpy(&bits.mantissa, bytes.data() + position, sizeof(bits.mantissa));
+	memcpy(&bits.sign_exponent, bytes.data() + position +
+	       sizeof(bits.mantissa), sizeof(bits.sign_exponent));
+	position += LONG_DOUBLE_BYTES;
+	return from_extended_bits(bits);
+}
+
+CheckpointWriter::CheckpointWriter(const std::string &path) :
+	path{path}
+{
+	writer = std::thread(&CheckpointWriter::writerLoop, this);
+}
+
+/**
+ * @brief writes the last submitted checkpoint, then stops the writer
+ */
+CheckpointWriter::~CheckpointWriter()
+{
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		stopping = true;
+	}
+	changed.notify_all();
+	writer.join();
+}
+
+void CheckpointWriter::submit(uint32_t kind, CheckpointData data)
+{
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		pending = std::move(data);
+		pending_kind = kind;
+		has_pending = true;
+	}
+	changed.notify_all();
+}
+
+void CheckpointWriter::wait()
+{
+	std::unique_lock<std::mutex> guard(lock);
+	changed.wait(guard, [this]() { return !has_pending && !busy; });
+	if (!error.empty())
+		throw std::runtime_error(error);
+}
+
+uint64_t CheckpointWriter::checkpointsWritten()
+{
+	std::lock_guard<std::mutex> guard(lock);
+	return written;
+}
+
+double CheckpointWriter::writeSeconds()
+{
+	std::lock_guard<std::mutex> guard(lock);
+	return write_seconds;
+}
+
+/**
+ * @brief writes to path.tmp, syncs it, then renames it over path, so a
+ * crash part way through leaves the previous checkpoint in place
+ */
+void write_checkpoint(const std::string &path, uint32_t kind,
+		      const CheckpointData &data)
+{
+	const std::vector<char> &payload = data.getBytes();
+	CheckpointHeader header;
+	memcpy(header.magic, CHECKPOINT_MAGIC, sizeof(header.magic));
+	header.version = CHECKPOINT_VERSION;
+	header.kind = kind;
+	header.length = payload.size();
+	header.checksum = fnv1a_hash(payload.data(), payload.size());
+
+	std::string temporary = path + ".tmp";
+	FILE *file = fopen(temporary.c_str(), "wb");
+	if (!file)
+		throw std::runtime_error("could not write " + temporary + ": "
+					 + strerror(errno));
+	bool ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+		fwrite(payload.data(), 1, payload.size(), file) == payload.size()
+		&& fflush(file) == 0 && fsync(fileno(file)) == 0;
+	ok = fclose(file) == 0 && ok;
+	if (!ok || rename(temporary.c_str(), path.c_str()) != 0)
+		throw std::runtime_error("could not write " + path + ": "
+					 + strerror(errno));
+}
+
+void CheckpointWriter::writerLoop()
+{
+	std::unique_lock<std::mutex> guard(lock);
+	for (;;) {
+		changed.wait(guard, [this]() { return has_pending || stopping; });
+		if (!has_pending)
+			break;
+
+		CheckpointData data = std::move(pending);
+		uint32_t kind = pending_kind;
+		has_pending = false;
+		busy = true;
+		guard.unlock();
+
+		auto start = std::chrono::steady_clock::now();
+		std::string failure;
+		try {
+			write_checkpoint(path, kind, data);
+		} catch (const std::exception &e) {
+			failure = e.what();
+		}
+		std::chrono::duration<double> time =
+			std::chrono::steady_clock::now() - start;
+
+		guard.lock();
+		busy = false;
+		write_seconds += time.count();
+		if (failure.empty())
+			written++;
+		else
+			error = failure;
+		changed.notify_all();
+	}
+}
+
+CheckpointData read_checkpoint(const std::string &path, uint32_t kind)
+{
+	std::ifstream in(path, std::ios::binary);
+	if (!in)
+		throw std::runtime_error("could not read " + path);
+
+	CheckpointHeader header;
+	if (!in.read((char *) &header, sizeof(header)) ||
+	    memcmp(header.magic, CHECKPOINT_MAGIC, sizeof(header.magic)) != 0)
+		throw std::runtime_error(path + " is not a checkpoint");
+	if (header.version != CHECKPOINT_VERSION)
+		throw std::runtime_error(path + " is checkpoint version "
+					 + std::to_string(header.version)
+					 + ", expected "
+					 + std::to_string(CHECKPOINT_VERSION));
+	if (header.kind != kind)
+		throw std::runtime_error(path + " is a checkpoint of another "
+					 "kind of run");
+
+	// the length is checked against the file before anything that size
+	// is allocated
+	std::streamoff start = in.tellg();
+	in.seekg(0, std::ios::end);
+	std::streamoff remaining = in.tellg() - start;
+	in.seekg(start);
+	if (remaining < 0 || header.length != (uint64_t) remaining)
+		throw std::runtime_error(path + " is damaged (payload is "
+					 + std::to_string(remaining)
+					 + " bytes, the header says "
+					 + std::to_string(header.length) + ")");
+
+	std::vector<char> payload(header.length);
+	if (!in.read(payload.data(), payload.size()) ||
+	    fnv1a_hash(payload.data(), payload.size()) != header.checksum)
+		throw std::runtime_error(path + " is damaged (bad checksum)");
+	return CheckpointData(std::move(payload));
+}
@@ -11,7 +11,7 @@
  */
 
 #include <ComptonEvent.hpp>
-#include <graphing.hpp>
+#include <iostream>
 #include <globals.hpp>
 
 /** 
@@ -0,0 +1,169 @@
+/**
+ * @file ComptonLibrary.cpp
+ * @brief The C interface of compton.h, built on the ComptonKernel formulas.
+ * Rows are evaluated a COMPTON_CHECK_BLOCK at a time in arrays on the
+ * stack, so nothing is allocated and calls never share any state.
+ */
+
+#include <compton.h>
+#include <ComptonKernel.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+
+static_assert(COMPTON_STATUS_BAD_THETA == COMPTON_BAD_THETA &&
+	      COMPTON_STATUS_BAD_LAMBDA == COMPTON_BAD_LAMBDA &&
+	      COMPTON_STATUS_NONFINITE_RESULT == COMPTON_NONFINITE_RESULT &&
+	      COMPTON_STATUS_ASIN_DOMAIN == COMPTON_ASIN_DOMAIN &&
+	      COMPTON_STATUS_NBITS == COMPTON_STATUS_BITS,
+	      "compton.h and ComptonKernel.hpp disagree on the status bits");
+static_assert(sizeof(compton_result_ld) == sizeof(ComptonResultValues) &&
+	      offsetof(compton_result_ld, electron_scatter_angle) ==
+	      offsetof(ComptonResultValues, electron_scatter_angle),
+	      "compton_result_ld must be laid out like ComptonResultValues");
+
+/**
+ * @brief evaluates and checks the rows a block at a time, handing each
+ * row to store, which copies it out and returns any status bits of its own
+ * @return the number of rows with a status other than 0
+ */
+template <typename Real, typename Store>
+static size_t evaluate_rows(const Real *theta, const Real *lambda_naught,
+			    uint32_t *status, size_t n,
+			    compton_error_counts *counts, Store store)
+{
+	long double block_theta[COMPTON_CHECK_BLOCK];
+	long double block_lambda[COMPTON_CHECK_BLOCK];
+	ComptonResultValues block[COMPTON_CHECK_BLOCK];
+	uint32_t block_status[COMPTON_CHECK_BLOCK];
+	uint64_t by_status[1 << COMPTON_STATUS_BITS] = {0};
+
+	for (size_t first = 0; first < n; first += COMPTON_CHECK_BLOCK) {
+		size_t rows = std::min(n - first, COMPTON_CHECK_BLOCK);
+		for (size_t i = 0; i < rows; ++i) {
+			block_theta[i] = theta[first + i];
+			block_lambda[i] = lambda_naught[first + i];
+		}
+		compton_evaluate_batch_checked(block_theta, block_lambda, block,
+					       block_status, rows);
+		for (size_t i = 0; i < rows; ++i) {
+			uint32_t row_status = block_status[i] |
+				store(first + i, block[i]);
+			by_status[row_status]++;
+			if (status)
+				status[first + i] = row_status;
+		}
+	}
+
+	ComptonErrorCounts total;
+	total.addHistogram(by_status);
+	if (counts) {
+		counts->rows = total.rows;
+		for (int b = 0; b < COMPTON_STATUS_BITS; ++b)
+			counts->bits[b] = total.bits[b];
+	}
+	return total.rows;
+}
+
+/**
+ * @brief 1 when a double input is NaN or infinite, or a wavelength is not
+ * above zero
+ */
+static size_t bad_inputs(double theta, double lambda_naught)
+{
+	return !std::isfinite(theta) || !std::isfinite(lambda_naught) ||
+		!(lambda_naught > 0);
+}
+
+extern "C" {
+
+int compton_abi_version(void)
+{
+	return COMPTON_ABI_VERSION;
+}
+
+const char *compton_status_text(int bit)
+{
+	return compton_status_name(bit);
+}
+
+size_t compton_batch_evaluate(const double *theta, const double *lambda_naught,
+			      compton_result *out, uint32_t *status, size_t n,
+			      compton_error_counts *counts)
+{
+	return evaluate_rows(theta, lambda_naught, status, n, counts,
+		[out](size_t i, const ComptonResultValues &r) -> uint32_t {
+			compton_result &o = out[i];
+			o.theta = r.theta;
+			o.lambda_naught = r.lambda_naught;
+			o.lambda_prime = r.lambda_prime;
+			o.photon_energy_naught = r.photon_energy_naught;
+			o.photon_energy_prime = r.photon_energy_prime;
+			o.photon_momentum_naught = r.photon_momentum_naught;
+			o.photon_momentum_prime = r.photon_momentum_prime;
+			o.electron_energy = r.electron_energy;
+			o.electron_velocity = r.electron_velocity;
+			o.electron_momentum = r.electron_momentum;
+			o.electron_scatter_angle = r.electron_scatter_angle;
+
+			// finite long doubles can still overflow a double
+			bool finite = std::isfinite(o.lambda_prime) &&
+				std::isfinite(o.photon_energy_naught) &&
+				std::isfinite(o.photon_energy_prime) &&
+				std::isfinite(o.photon_momentum_naught) &&
+				std::isfinite(o.photon_momentum_prime) &&
+				std::isfinite(o.electron_energy) &&
+				std::isfinite(o.electron_velocity) &&
+				std::isfinite(o.electron_momentum) &&
+				std::isfinite(o.electron_scatter_angle);
+			return finite ? 0 : COMPTON_NONFINITE_RESULT;
+		});
+}
+
+size_t compton_batch_evaluate_ld(const long double *theta,
+				 const long double *lambda_naught,
+				 compton_result_ld *out, uint32_t *status,
+				 size_t n, compton_error_counts *counts)
+{
+	return evaluate_rows(theta, lambda_naught, status, n, counts,
+		[out](size_t i, const ComptonResultValues &r) -> uint32_t {
+			memcpy(&out[i], &r, sizeof(r));
+			return 0;
+		});
+}
+
+size_t compton_batch_lambda_prime(const double *theta,
+				  const double *lambda_naught,
+				  double *lambda_prime, size_t n)
+{
+	size_t errors = 0;
+	for (size_t i = 0; i < n; ++i) {
+		long double lambda = (long double) lambda_naught[i]
+			* pow(10, -12);
+		lambda_prime[i] = compton_lambda_prime(lambda,
+			cos((long double) theta[i] / (180 / M_PI)));
+		errors += bad_inputs(theta[i], lambda_naught[i]) |
+			!std::isfinite(lambda_prime[i]);
+	}
+	return errors;
+}
+
+size_t compton_batch_klein_nishina(const double *theta,
+				   const double *lambda_naught,
+				   double *cross_section, size_t n)
+{
+	size_t errors = 0;
+	for (size_t i = 0; i < n; ++i) {
+		long double angle = (long double) theta[i] / (180 / M_PI);
+		long double lambda = (long double) lambda_naught[i]
+			* pow(10, -12);
+		cross_section[i] = klein_nishina(lambda,
+			compton_lambda_prime(lambda, cos(angle)), sin(angle));
+		errors += bad_inputs(theta[i], lambda_naught[i]) |
+			!std::isfinite(cross_section[i]);
+	}
+	return errors;
+}
+
+}
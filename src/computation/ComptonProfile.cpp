@@ -0,0 +1,178 @@
+/**
+ * @file ComptonProfile.cpp
+ * @brief Doppler broadening of the scattered wavelength by bound electrons,
+ * using tabulated Compton profiles
+ */
+
+#include <ComptonProfile.hpp>
+#include <ComptonKernel.hpp>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+/**
+ * @brief builds the inverse CDF table. The tabulated half profile is
+ * mirrored to negative p_z, integrated with the trapezoid rule and then
+ * inverted at evenly spaced probabilities.
+ */
+ComptonProfile::ComptonProfile(const std::string &element,
+			       const std::vector<long double> &p_z,
+			       const std::vector<long double> &j,
+			       std::size_t table_size) :
+	element{element}
+{
+	if (p_z.size() < 2 || p_z.size() != j.size() || table_size < 2)
+		throw std::invalid_argument("bad Compton profile table for "
+					    + element);
+
+	// the full, symmetric profile from -p_max to p_max
+	std::vector<long double> x, y;
+	for (std::size_t i = p_z.size(); i-- > 1;) {
+		x.push_back(-p_z[i]);
+		y.push_back(j[i]);
+	}
+	if (p_z[0] > 0) {
+		x.push_back(-p_z[0]);
+		y.push_back(j[0]);
+	}
+	for (std::size_t i = 0; i < p_z.size(); ++i) {
+		x.push_back(p_z[i]);
+		y.push_back(j[i]);
+	}
+
+	std::vector<long double> cdf(x.size(), 0);
+	for (std::size_t i = 1; i < x.size(); ++i)
+		cdf[i] = cdf[i - 1] + (x[i] - x[i - 1]) * (y[i] + y[i - 1]) / 2;
+	if (cdf.back() <= 0)
+		throw std::invalid_argument("empty Compton profile for "
+					    + element);
+
+	inverse_cdf.resize(table_size);
+	std::size_t seg = 1;
+	for (std::size_t k = 0; k < table_size; ++k) {
+		long double target = cdf.back() * k / (table_size - 1);
+		while (seg < x.size() - 1 && cdf[seg] < target)
+			++seg;
+		long double width = cdf[seg] - cdf[seg - 1];
+		long double frac = width > 0 ?
+			(target - cdf[seg - 1]) / width : 0;
+		inverse_cdf[k] = x[seg - 1] + frac * (x[seg] - x[seg - 1]);
+	}
+}
+
+/**
+ * @brief maps a uniform random number in [0, 1] to a p_z, O(1)
+ */
+long double ComptonProfile::samplePz(long double u) const
+{
+	long double pos = std::min(std::max(u, 0.0L), 1.0L)
+		* (inverse_cdf.size() - 1);
+	std::size_t i = std::min((std::size_t) pos, inverse_cdf.size() - 2);
+	long double frac = pos - i;
+	return inverse_cdf[i] + frac * (inverse_cdf[i + 1] - inverse_cdf[i]);
+}
+
+/**
+ * @brief the broadened distribution of the scattered wavelength. Every
+ * entry of the inverse CDF table carries the same probability, so each one
+ * is mapped to its wavelength and deposited on the grid.
+ */
+BinnedSpectrum ComptonProfile::broadenedSpectrum(long double theta,
+						 long double lambda_naught,
+						 std::size_t bins) const
+{
+	long double lambda = lambda_naught * pow(10, -12);
+	long double cos_theta = cos(theta / (180 / M_PI));
+	std::size_t n = inverse_cdf.size();
+
+	// positive p_z gives a more energetic photon, so a shorter wavelength.
+	// The profiles have long tails, so the grid only covers the central
+	// 99.8% of the distribution to keep the bins narrow around the peak.
+	long double shortest =
+		doppler_lambda_prime(lambda, cos_theta, samplePz(0.999L));
+	long double longest =
+		doppler_lambda_prime(lambda, cos_theta, samplePz(0.001L));
+
+	BinnedSpectrum spectrum;
+	spectrum.bin_width = std::max(longest - shortest, lambda * 1E-9L) / bins;
+	spectrum.start = shortest;
+	spectrum.counts.assign(bins, 0);
+	for (std::size_t k = 0; k + 1 < n; ++k) {
+		long double p = (inverse_cdf[k] + inverse_cdf[k + 1]) / 2;
+		spectrum.deposit(doppler_lambda_prime(lambda, cos_theta, p),
+				 1.0L / (n - 1));
+	}
+	return spectrum;
+}
+
+/**
+ * @brief reads <directory>/<element>.txt (p_z, J(p_z) columns)
+ */
+ComptonProfile load_compton_profile(const std::string &element,
+				    const std::string &directory)
+{
+	std::string path = directory + "/" + element + ".txt";
+	std::ifstream in(path);
+	if (!in)
+		throw std::runtime_error("could not open Compton profile " + path);
+
+	std::vector<long double> p_z, j;
+	std::string line;
+	while (std::getline(in, line)) {
+		if (line.empty() || line[0] == '#')
+			continue;
+		std::istringstream row(line);
+		long double p, value;
+		if (!(row >> p >> value) || p < 0)
+			continue;
+		p_z.push_back(p);
+		j.push_back(value);
+	}
+	if (p_z.empty())
+		throw std::runtime_error("no profile rows in " + path);
+	return ComptonProfile(element, p_z, j);
+}
+
+/**
+ * @brief scattered wavelength off an electron with momentum p_z.
+ *
+ * With energies in units of m_0 c^2, e before and x after the collision,
+ * and q = p_z / (m_0 c), the impulse approximation gives
+ * q * sqrt(e^2 + x^2 - 2ex cos(theta)) = x * a - e, a = 1 + e(1 - cos(theta))
+ * Squaring gives a quadratic in x; the root on the same side of the free
+ * electron result e / a as q is the one we want.
+ */
+long double doppler_lambda_prime(long double lambda_naught,
+				 long double cos_theta, long double p_z)
+{
+	long double e = COMPTON_WAVELENGTH / lambda_naught;
+	long double q = p_z * FINE_STRUCTURE;
+	long double q2 = q * q;
+	long double a = 1 + e * (1 - cos_theta);
+
+	long double b = a - q2 * cos_theta;
+	long double disc = b * b - (a * a - q2) * (1 - q2);
+	long double root = sqrt(std::max(disc, 0.0L));
+	long double x = e * (b + (q < 0 ? -root : root)) / (a * a - q2);
+
+	// x is only <= 0 for momenta far outside any real profile
+	if (x <= 0)
+		return compton_lambda_prime(lambda_naught, cos_theta);
+	return COMPTON_WAVELENGTH / x;
+}
+
+/**
+ * @brief the compton_evaluate() results with a Doppler broadened wavelength
+ */
+ComptonResultValues compton_evaluate_bound(long double theta,
+					   long double lambda_naught,
+					   const ComptonProfile &profile,
+					   long double u)
+{
+	long double lambda = lambda_naught * pow(10, -12);
+	long double lambda_prime =
+		doppler_lambda_prime(lambda, cos(theta / (180 / M_PI)),
+				     profile.samplePz(u));
+	return compton_results_from_wavelengths(theta, lambda, lambda_prime);
+}
@@ -0,0 +1,215 @@
+/**
+ * @file ComptonSpectrum.cpp
+ * @brief scattering of binned incident spectra, built on the formulas in
+ * ComptonKernel.hpp
+ */
+
+#include <ComptonSpectrum.hpp>
+#include <ComptonKernel.hpp>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+/**
+ * @brief adds value to a grid at a (fractional) position, split linearly
+ * between the two bins around it. Anything outside the grid is dropped.
+ */
+void BinnedSpectrum::deposit(long double x, long double value)
+{
+	long long n = (long long) counts.size();
+	if (x < start || x > start + n * bin_width)
+		return;
+
+	// position in units of bins, measured from the first bin center. The
+	// outer half bins only have one neighbour.
+	long double pos = (x - start) / bin_width - 0.5L;
+	if (pos <= 0) {
+		counts[0] += value;
+		return;
+	}
+	if (pos >= n - 1) {
+		counts[n - 1] += value;
+		return;
+	}
+
+	long long i = (long long) pos;
+	long double frac = pos - i;
+	counts[i] += (1 - frac) * value;
+	counts[i + 1] += frac * value;
+}
+
+/**
+ * @brief sum of all of the bins
+ */
+long double BinnedSpectrum::total() const
+{
+	long double sum = 0;
+	for (long double c : counts)
+		sum += c;
+	return sum;
+}
+
+/**
+ * @brief reads a two column (picometers, intensity) spectrum file
+ */
+std::vector<SpectrumPoint> load_spectrum(const std::string &path)
+{
+	std::ifstream in(path);
+	if (!in)
+		throw std::runtime_error("could not open spectrum file " + path);
+
+	std::vector<SpectrumPoint> points;
+	std::string line;
+	while (std::getline(in, line)) {
+		if (line.empty() || line[0] == '#')
+			continue;
+		std::istringstream row(line);
+		SpectrumPoint p;
+		if (!(row >> p.lambda >> p.intensity))
+			continue;
+		if (p.lambda > 0 && p.intensity > 0)
+			points.push_back(p);
+	}
+	if (points.empty())
+		throw std::runtime_error("no spectrum rows in " + path);
+
+	std::sort(points.begin(), points.end(),
+		  [](const SpectrumPoint &a, const SpectrumPoint &b)
+		  { return a.lambda < b.lambda; });
+	return points;
+}
+
+/**
+ * @brief puts the spectrum rows on a uniform wavelength grid (meters)
+ */
+BinnedSpectrum bin_spectrum(const std::vector<SpectrumPoint> &points,
+			    std::size_t bins)
+{
+	long double low = points.front().lambda * pow(10, -12);
+	long double high = points.back().lambda * pow(10, -12);
+	BinnedSpectrum spectrum;
+
+	if (bins < 2)
+		throw std::invalid_argument("a spectrum needs at least 2 bins");
+
+	// a single line still gets a (narrow) grid around it
+	if (high <= low)
+		high = low * 1.001L;
+	spectrum.bin_width = (high - low) / (bins - 1);
+	spectrum.start = low - spectrum.bin_width / 2;
+	spectrum.counts.assign(bins, 0);
+
+	for (const SpectrumPoint &p : points)
+		spectrum.deposit(p.lambda * pow(10, -12), p.intensity);
+	return spectrum;
+}
+
+/**
+ * @brief sets up empty photon and electron grids that are wide enough for
+ * anything the incident spectrum can scatter into
+ */
+static ScatteredSpectrum make_output_grids(const BinnedSpectrum &incident)
+{
+	ScatteredSpectrum out;
+	std::size_t bins = incident.counts.size();
+
+	// the photon can gain at most two Compton wavelengths (back scatter)
+	long double extra = ceil(2 * COMPTON_WAVELENGTH / incident.bin_width);
+	out.photon.start = incident.start;
+	out.photon.bin_width = incident.bin_width;
+	out.photon.counts.assign(bins + (std::size_t) extra + 1, 0);
+
+	// the shortest wavelength gives the most energetic electron
+	long double shortest = std::max(incident.start, incident.bin_width / 2);
+	long double e_max = electron_energy(shortest, shortest +
+					    2 * COMPTON_WAVELENGTH);
+	out.electron.start = 0;
+	out.electron.bin_width = e_max / bins;
+	out.electron.counts.assign(bins, 0);
+	return out;
+}
+
+/**
+ * @brief scatters every incident bin at one angle, weighted by weight[i]
+ * @param shift the wavelength shift for this angle in meters
+ */
+static void scatter_into(const BinnedSpectrum &incident, long double shift,
+			 const long double *weight, ScatteredSpectrum &out)
+{
+	for (std::size_t i = 0; i < incident.counts.size(); ++i) {
+		long double value = incident.counts[i] * weight[i];
+		if (value == 0)
+			continue;
+		long double lambda = incident.binCenter(i);
+		out.photon.deposit(lambda + shift, value);
+		out.electron.deposit(electron_energy(lambda, lambda + shift),
+				     value);
+	}
+}
+
+/**
+ * @brief scattered spectra for photons that all scatter at one angle
+ */
+ScatteredSpectrum scatter_spectrum(const BinnedSpectrum &incident,
+				   long double theta)
+{
+	ScatteredSpectrum out = make_output_grids(incident);
+	std::vector<long double> weight(incident.counts.size(), 1);
+	long double shift = compton_lambda_prime(0, cos(theta / (180 / M_PI)));
+
+	scatter_into(incident, shift, weight.data(), out);
+	return out;
+}
+
+/**
+ * @brief scattered spectra over all angles weighted by Klein-Nishina
+ */
+ScatteredSpectrum scatter_spectrum_all_angles(const BinnedSpectrum &incident,
+					      std::size_t theta_steps)
+{
+	ScatteredSpectrum out = make_output_grids(incident);
+	std::size_t bins = incident.counts.size();
+	long double step = M_PI / theta_steps;
+
+	// weights[j * bins + i] is the probability of bin i scattering into
+	// angle j, so normalize every bin over all of the angles
+	std::vector<long double> weights(theta_steps * bins);
+	std::vector<long double> norm(bins, 0);
+	for (std::size_t j = 0; j < theta_steps; ++j) {
+		long double theta = (j + 0.5L) * step;
+		long double cos_theta = cos(theta), sin_theta = sin(theta);
+		for (std::size_t i = 0; i < bins; ++i) {
+			long double lambda = incident.binCenter(i);
+			long double w = klein_nishina(lambda,
+				compton_lambda_prime(lambda, cos_theta),
+				sin_theta) * 2 * M_PI * sin_theta * step;
+			weights[j * bins + i] = w;
+			norm[i] += w;
+		}
+	}
+
+	for (std::size_t j = 0; j < theta_steps; ++j) {
+		long double *w = &weights[j * bins];
+		for (std::size_t i = 0; i < bins; ++i)
+			w[i] = norm[i] > 0 ? w[i] / norm[i] : 0;
+		long double shift =
+			compton_lambda_prime(0, cos((j + 0.5L) * step));
+		scatter_into(incident, shift, w, out);
+	}
+	return out;
+}
+
+/**
+ * @brief writes a binned spectrum as two columns (bin center, counts)
+ */
+void write_spectrum(const BinnedSpectrum &spectrum, const std::string &path)
+{
+	std::ofstream out(path);
+	if (!out)
+		throw std::runtime_error("could not write " + path);
+
+	out.precision(10);
+	for (std::size_t i = 0; i < spectrum.counts.size(); ++i)
+		out << spectrum.binCenter(i) << ' ' << spectrum.counts[i] << '\n';
+}
@@ -0,0 +1,135 @@
+/**
+ * @file ComptonSweep.cpp
+ * @brief ComptonSweep member function definitions. Every row gives exactly
+ * the same values as compton_evaluate() for its angle and wavelength.
+ */
+
+#include <ComptonSweep.hpp>
+#include <algorithm>
+#include <stdexcept>
+
+ComptonSweep::ComptonSweep(long double theta_min, long double theta_max,
+			   std::size_t steps, long double lambda_naught)
+{
+	lambda_picometers = lambda_naught;
+	this->lambda_naught = lambda_naught * pow(10, -12);
+	energy_naught = photon_energy(this->lambda_naught);
+	momentum_naught = photon_momentum(this->lambda_naught);
+	setThetaRange(theta_min, theta_max, steps);
+}
+
+/**
+ * @brief the theta only terms of row i
+ */
+void ComptonSweep::setAngleTerms(std::size_t i, long double theta)
+{
+	long double theta_rad = theta / (180 / M_PI);
+
+	this->theta[i] = theta;
+	sin_theta[i] = sin(theta_rad);
+	shift[i] = compton_lambda_prime(0, cos(theta_rad));
+}
+
+/**
+ * @brief recalculates row i from the cached theta and lambda terms, the
+ * same steps as compton_results_from_wavelengths()
+ */
+void ComptonSweep::updateRow(std::size_t i)
+{
+	ComptonResultValues &r = results[i];
+
+	r.theta = theta[i];
+	r.lambda_naught = lambda_naught;
+	r.lambda_prime = lambda_naught + shift[i];
+	r.photon_energy_naught = energy_naught;
+	r.photon_energy_prime = photon_energy(r.lambda_prime);
+	r.photon_momentum_naught = momentum_naught;
+	r.photon_momentum_prime = photon_momentum(r.lambda_prime);
+	r.electron_energy = r.photon_energy_naught - r.photon_energy_prime;
+	r.electron_velocity = sqrt(2 * r.electron_energy / M_NAUGHT);
+	r.electron_momentum = M_NAUGHT * r.electron_velocity;
+	r.electron_scatter_angle =
+		asin(r.photon_momentum_prime * sin_theta[i]
+		     / r.electron_momentum) * 180 / M_PI;
+}
+
+/**
+ * @brief recalculates every row and checks it, a block at a time like
+ * compton_evaluate_batch_checked()
+ */
+void ComptonSweep::updateRows()
+{
+	std::size_t n = results.size();
+	for (std::size_t first = 0; first < n; first += COMPTON_CHECK_BLOCK) {
+		std::size_t last = std::min(n, first + COMPTON_CHECK_BLOCK);
+		for (std::size_t i = first; i < last; ++i)
+			updateRow(i);
+		for (std::size_t i = first; i < last; ++i)
+			status[i] = compton_status(theta[i], lambda_picometers,
+						   results[i]);
+	}
+}
+
+/**
+ * @brief changes the incident wavelength (picometers), no trigonometry
+ * is recalculated
+ */
+void ComptonSweep::setLambda(long double lambda_naught)
+{
+	lambda_picometers = lambda_naught;
+	this->lambda_naught = lambda_naught * pow(10, -12);
+	energy_naught = photon_energy(this->lambda_naught);
+	momentum_naught = photon_momentum(this->lambda_naught);
+	updateRows();
+}
+
+/**
+ * @brief changes a single angle (degrees), only that row is recalculated
+ */
+void ComptonSweep::setTheta(std::size_t i, long double theta)
+{
+	setAngleTerms(i, theta);
+	updateRow(i);
+	status[i] = compton_status(this->theta[i], lambda_picometers,
+				   results[i]);
+}
+
+/**
+ * @brief replaces every angle, keeping the incident wavelength terms
+ */
+void ComptonSweep::setThetaRange(long double theta_min, long double theta_max,
+				 std::size_t steps)
+{
+	if (steps < 2)
+		throw std::invalid_argument("a sweep needs at least 2 angles");
+
+	theta.resize(steps);
+	sin_theta.resize(steps);
+	shift.resize(steps);
+	results.resize(steps);
+	status.resize(steps);
+	for (std::size_t i = 0; i < steps; ++i)
+		setAngleTerms(i, angle(theta_min, theta_max, steps, i));
+	updateRows();
+}
+
+/**
+ * @brief how many rows have each status bit set
+ */
+ComptonErrorCounts ComptonSweep::errorCounts() const
+{
+	uint64_t by_status[1 << COMPTON_STATUS_BITS] = {0};
+	for (uint32_t s : status)
+		by_status[s]++;
+	ComptonErrorCounts counts;
+	counts.addHistogram(by_status);
+	return counts;
+}
+
+/**
+ * @brief the incident wavelength in picometers
+ */
+long double ComptonSweep::getLambda() const
+{
+	return lambda_picometers;
+}
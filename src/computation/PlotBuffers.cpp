@@ -0,0 +1,92 @@
+/**
+ * @file PlotBuffers.cpp
+ * @brief filling and thinning the sample buffers for the angular plots
+ */
+
+#include <PlotBuffers.hpp>
+#include <ComptonKernel.hpp>
+#include <algorithm>
+
+/**
+ * @brief fills the plot buffers from every finite row of a sweep
+ */
+ScatterPlotBuffers make_scatter_plot_buffers(const ComptonSweep &sweep)
+{
+	ScatterPlotBuffers b;
+	std::size_t n = sweep.size();
+	std::vector<float> *columns[] = {
+		&b.theta, &b.lambda_prime, &b.electron_phi, &b.intensity,
+		&b.photon_radial, &b.photon_axial,
+		&b.electron_radial, &b.electron_axial};
+	for (std::vector<float> *column : columns)
+		column->reserve(n);
+
+	for (std::size_t i = 0; i < n; ++i) {
+		const ComptonResultValues &r = sweep[i];
+		if (!std::isfinite(r.lambda_prime) ||
+		    !std::isfinite(r.electron_scatter_angle))
+			continue;
+
+		long double theta = r.theta / (180 / M_PI);
+		long double sin_theta = sin(theta);
+		long double intensity = klein_nishina(r.lambda_naught,
+						      r.lambda_prime, sin_theta)
+			/ (ELECTRON_RADIUS * ELECTRON_RADIUS);
+
+		b.theta.push_back(theta);
+		b.lambda_prime.push_back(r.lambda_prime / pow(10, -12));
+		b.electron_phi.push_back(r.electron_scatter_angle);
+		b.intensity.push_back(intensity);
+
+		// the electron leaves on the other side of the incident axis
+		long double phi = r.electron_scatter_angle / (180 / M_PI);
+		long double share = r.electron_energy / r.photon_energy_naught;
+		b.photon_radial.push_back(intensity * sin_theta);
+		b.photon_axial.push_back(intensity * cos(theta));
+		b.electron_radial.push_back(-share * sin(phi));
+		b.electron_axial.push_back(share * cos(phi));
+	}
+	return b;
+}
+
+/**
+ * @brief level of detail, keeps the first row and the extremes of every
+ * series in each bucket
+ */
+std::vector<std::size_t> downsample_indices(
+	const std::vector<const std::vector<float> *> &series,
+	std::size_t max_points)
+{
+	std::vector<std::size_t> keep;
+	std::size_t n = series.empty() ? 0 : series[0]->size();
+	std::size_t per_bucket = 1 + 2 * series.size();
+
+	if (n <= max_points) {
+		for (std::size_t i = 0; i < n; ++i)
+			keep.push_back(i);
+		return keep;
+	}
+
+	std::size_t buckets = std::max<std::size_t>(1, max_points / per_bucket);
+	for (std::size_t k = 0; k < buckets; ++k) {
+		std::size_t first = n * k / buckets;
+		std::size_t last = n * (k + 1) / buckets;
+		std::size_t start = keep.size();
+
+		keep.push_back(first);
+		for (const std::vector<float> *s : series) {
+			auto lo = std::min_element(s->begin() + first,
+						   s->begin() + last);
+			auto hi = std::max_element(s->begin() + first,
+						   s->begin() + last);
+			keep.push_back(lo - s->begin());
+			keep.push_back(hi - s->begin());
+		}
+		std::sort(keep.begin() + start, keep.end());
+		keep.erase(std::unique(keep.begin() + start, keep.end()),
+			   keep.end());
+	}
+	if (keep.back() != n - 1)
+		keep.push_back(n - 1);
+	return keep;
+}
@@ -0,0 +1,863 @@
+/**
+ * @file ResultArchive.cpp
+ * @brief Compressed column files of result rows, see ResultArchive.hpp
+ */
+
+#include <ResultArchive.hpp>
+#include <Checkpoint.hpp>
+#include <ComptonKernel.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+static const char ARCHIVE_MAGIC[8] = {'C', 'O', 'M', 'P', 'T', 'A', 'R', 'C'};
+static const char ARCHIVE_END[8] = {'C', 'O', 'M', 'P', 'T', 'E', 'N', 'D'};
+
+// chunk count, rows, index offset and the end magic
+static const std::size_t FOOTER_BYTES = 32;
+
+// theta and lambda_naught are always stored and every stored value takes
+// at least one bit, so a chunk can't hold more rows than this per byte
+static const uint64_t MAX_ROWS_PER_BYTE = 4;
+
+const char *const RESULT_COLUMN_NAMES[RESULT_COLUMNS] = {
+	"theta", "lambda_naught", "lambda_prime", "photon_energy_naught",
+	"photon_energy_prime", "photon_momentum_naught",
+	"photon_momentum_prime", "electron_energy", "electron_velocity",
+	"electron_momentum", "electron_scatter_angle"
+};
+
+static long double ComptonResultValues::*const COLUMN_MEMBERS[RESULT_COLUMNS] = {
+	&ComptonResultValues::theta,
+	&ComptonResultValues::lambda_naught,
+	&ComptonResultValues::lambda_prime,
+	&ComptonResultValues::photon_energy_naught,
+	&ComptonResultValues::photon_energy_prime,
+	&ComptonResultValues::photon_momentum_naught,
+	&ComptonResultValues::photon_momentum_prime,
+	&ComptonResultValues::electron_energy,
+	&ComptonResultValues::electron_velocity,
+	&ComptonResultValues::electron_momentum,
+	&ComptonResultValues::electron_scatter_angle
+};
+
+// theta and lambda_naught are the inputs, everything else can be rebuilt
+static const bool DERIVABLE[RESULT_COLUMNS] = {
+	false, false, true, true, true, true, true, true, true, true, true
+};
+
+std::size_t result_column_index(const std::string &name)
+{
+	for (std::size_t c = 0; c < RESULT_COLUMNS; ++c)
+		if (name == RESULT_COLUMN_NAMES[c])
+			return c;
+	throw std::invalid_argument("no result column " + name);
+}
+
+/**
+ * @brief rebuilds a derivable column from the columns before it, with the
+ * same formulas as compton_evaluate()
+ */
+static long double rebuild_column(std::size_t column,
+				  const ComptonResultValues &r)
+{
+	long double radians = r.theta / (180 / M_PI);
+	switch (column) {
+	case 2: return compton_lambda_prime(r.lambda_naught, cos(radians));
+	case 3: return photon_energy(r.lambda_naught);
+	case 4: return photon_energy(r.lambda_prime);
+	case 5: return photon_momentum(r.lambda_naught);
+	case 6: return photon_momentum(r.lambda_prime);
+	case 7: return r.photon_energy_naught - r.photon_energy_prime;
+	case 8: return sqrt(2 * r.electron_energy / M_NAUGHT);
+	case 9: return M_NAUGHT * r.electron_velocity;
+	case 10: return asin(r.photon_momentum_prime * sin(radians)
+			     / r.electron_momentum) * 180 / M_PI;
+	}
+	throw std::logic_error("column " + std::to_string(column)
+			       + " can't be rebuilt");
+}
+
+// a value in its column's precision: the bits that change from row to row
+// (all of a double or float, the mantissa of a long double) and the sign
+// and exponent word of a long double
+struct ColumnBits {
+	uint64_t low;
+	uint16_t high;
+
+	bool operator==(const ColumnBits &o) const
+	{
+		return low == o.low && high == o.high;
+	}
+};
+
+static int stored_width(ColumnPrecision precision)
+{
+	return precision == ColumnPrecision::FLOAT ? 32 : 64;
+}
+
+static int fraction_bits(ColumnPrecision precision)
+{
+	switch (precision) {
+	case ColumnPrecision::LONG_DOUBLE: return 63;
+	case ColumnPrecision::DOUBLE: return 52;
+	case ColumnPrecision::FLOAT: return 23;
+	}
+	return 0;
+}
+
+static ColumnBits to_bits(long double value, ColumnPrecision precision)
+{
+	ColumnBits bits{0, 0};
+	if (precision == ColumnPrecision::LONG_DOUBLE) {
+		ExtendedBits extended = to_extended_bits(value);
+		bits.low = extended.mantissa;
+		bits.high = extended.sign_exponent;
+	} else if (precision == ColumnPrecision::DOUBLE) {
+		double d = value;
+		memcpy(&bits.low, &d, sizeof(d));
+	} else {
+		float f = value;
+		uint32_t word;
+		memcpy(&word, &f, sizeof(f));
+		bits.low = word;
+	}
+	return bits;
+}
+
+static long double from_bits(ColumnBits bits, ColumnPrecision precision)
+{
+	if (precision == ColumnPrecision::LONG_DOUBLE) {
+		return from_extended_bits({bits.low, bits.high});
+	} else if (precision == ColumnPrecision::DOUBLE) {
+		double d;
+		memcpy(&d, &bits.low, sizeof(d));
+		return d;
+	}
+	uint32_t word = bits.low;
+	float f;
+	memcpy(&f, &word, sizeof(f));
+	return f;
+}
+
+// theta and lambda_naught keep this many more bits than their error bound
+// needs: every rebuilt column is calculated from them, and some move by up
+// to about twice their relative error (the electron energy goes as
+// 1 / lambda_naught^2)
+static const int ROOT_GUARD_BITS = 2;
+
+/**
+ * @brief a value as it is stored: in the column's precision, with the
+ * mantissa bits its error bound doesn't need cleared
+ * @param guard_bits how many more bits to keep than the bound needs
+ */
+static ColumnBits reduce(long double value, const ArchiveColumn &column,
+			 int guard_bits)
+{
+	ColumnBits bits = to_bits(value, column.precision);
+	if (column.error <= 0 ||
+	    !std::isfinite(from_bits(bits, column.precision)))
+		return bits;
+
+	// clearing all but keep fraction bits is off by less than 2^-keep
+	int fraction = fraction_bits(column.precision);
+	int keep = std::max(1, (int) ceill(-log2l(column.error))) + guard_bits;
+	if (keep < fraction)
+		bits.low &= ~((1ULL << (fraction - keep)) - 1);
+	return bits;
+}
+
+/**
+ * @brief how far a rebuilt value can be from the stored one, as a fraction
+ * of the column's largest value in the chunk: the error bound, and for a
+ * column reduced to double or float four units in its last place, as the
+ * rebuilt value is calculated from theta and lambda_naught rounded to their
+ * precision and is then rounded again itself
+ */
+static long double rebuild_tolerance(const ArchiveColumn &column)
+{
+	if (column.precision == ColumnPrecision::LONG_DOUBLE)
+		return column.error;
+	return std::max(column.error,
+			ldexpl(1, 2 - fraction_bits(column.precision)));
+}
+
+class BitWriter {
+private:
+	std::vector<uint64_t> words;
+	int used = 64;
+
+public:
+	// value must fit in bits, 0 to 64
+	void put(uint64_t value, int bits)
+	{
+		if (bits == 0)
+			return;
+		if (used == 64) {
+			words.push_back(0);
+			used = 0;
+		}
+		words.back() |= value << used;
+		int room = 64 - used;
+		if (bits > room) {
+			words.push_back(value >> room);
+			used = bits - room;
+		} else {
+			used += bits;
+		}
+	}
+
+	const std::vector<uint64_t> &getWords() const { return words; }
+};
+
+class BitReader {
+private:
+	const uint64_t *words;
+	std::size_t count;
+	std::size_t word = 0;
+	int used = 0;
+
+public:
+	BitReader(const uint64_t *words, std::size_t count)
+		: words{words}, count{count} {}
+
+	uint64_t get(int bits)
+	{
+		if (bits == 0)
+			return 0;
+		if (word >= count)
+			throw std::runtime_error("result archive column is "
+						 "shorter than expected");
+		uint64_t value = words[word] >> used;
+		int room = 64 - used;
+		if (bits >= room) {
+			word++;
+			used = 0;
+			if (bits > room) {
+				if (word >= count)
+					throw std::runtime_error("result archive "
+						"column is shorter than expected");
+				value |= words[word] << room;
+				used = bits - room;
+			}
+		} else {
+			used += bits;
+		}
+		return bits == 64 ? value : value & ((1ULL << bits) - 1);
+	}
+};
+
+// how a stored column predicts each value from the ones before it, and
+// how the value's difference from the prediction is written
+enum class Prediction : uint8_t {
+	PREVIOUS_XOR,     // the previous value, bits that differ (Gorilla)
+	LINE_XOR,         // a straight line through the last two, bits that differ
+	LINE_DIFFERENCE   // the same line, the integer difference
+};
+const int PREDICTIONS = 3;
+
+/**
+ * @brief the value a column is expected to have next, a straight line
+ * suits evenly spaced columns such as theta in a sweep
+ */
+static ColumnBits predict(const ColumnBits &previous, const ColumnBits &before,
+			  Prediction prediction, int width)
+{
+	if (prediction == Prediction::PREVIOUS_XOR ||
+	    previous.high != before.high)
+		return previous;
+	ColumnBits guess = previous;
+	guess.low = previous.low * 2 - before.low;
+	if (width < 64)
+		guess.low &= (1ULL << width) - 1;
+	return guess;
+}
+
+/**
+ * @brief the difference between a value and its prediction. The integer
+ * difference is zigzag encoded so it is small either side of zero, which
+ * is where values a rounding step off the line end up.
+ */
+static uint64_t residual(uint64_t value, uint64_t guess, Prediction prediction,
+			 int width)
+{
+	if (prediction != Prediction::LINE_DIFFERENCE)
+		return value ^ guess;
+	int64_t d = (int64_t) ((value - guess) << (64 - width)) >> (64 - width);
+	uint64_t z = ((uint64_t) d << 1) ^ (uint64_t) (d >> 63);
+	return width < 64 ? z & ((1ULL << width) - 1) : z;
+}
+
+static uint64_t apply_residual(uint64_t guess, uint64_t x,
+			       Prediction prediction, int width)
+{
+	if (prediction != Prediction::LINE_DIFFERENCE)
+		return guess ^ x;
+	uint64_t value = guess + ((x >> 1) ^ -(x & 1));
+	return width < 64 ? value & ((1ULL << width) - 1) : value;
+}
+
+/**
+ * @brief Gorilla style compression of one column of a chunk, the first
+ * two bits of the stream say which prediction it uses
+ */
+class ColumnEncoder {
+private:
+	BitWriter bits;
+	ColumnBits previous{0, 0};
+	ColumnBits before{0, 0};
+	int width;
+	bool has_high;
+	Prediction prediction;
+	int leading = -1;
+	int trailing = 0;
+
+public:
+	ColumnEncoder(ColumnPrecision precision, Prediction prediction)
+		: width{stored_width(precision)},
+		  has_high{precision == ColumnPrecision::LONG_DOUBLE},
+		  prediction{prediction}
+	{
+		bits.put((uint64_t) prediction, 2);
+	}
+
+	void put(ColumnBits value)
+	{
+		if (has_high) {
+			if (value.high == previous.high) {
+				bits.put(0, 1);
+			} else {
+				bits.put(1, 1);
+				bits.put(value.high, 16);
+			}
+		}
+		uint64_t x = residual(value.low, predict(previous, before,
+					prediction, width).low, prediction, width);
+		before = previous;
+		previous = value;
+		if (x == 0) {
+			bits.put(0, 1);
+			return;
+		}
+		bits.put(1, 1);
+
+		int lz = __builtin_clzll(x) - (64 - width);
+		int tz = __builtin_ctzll(x);
+		if (leading >= 0 && lz >= leading && tz >= trailing) {
+			// the difference fits in the previous window
+			bits.put(0, 1);
+			bits.put(x >> trailing, width - leading - trailing);
+			return;
+		}
+		bits.put(1, 1);
+		bits.put(lz, 6);
+		bits.put(width - lz - tz - 1, 6);
+		bits.put(x >> tz, width - lz - tz);
+		leading = lz;
+		trailing = tz;
+	}
+
+	const std::vector<uint64_t> &getWords() const { return bits.getWords(); }
+};
+
+class ColumnDecoder {
+private:
+	BitReader bits;
+	ColumnBits previous{0, 0};
+	ColumnBits before{0, 0};
+	int width;
+	bool has_high;
+	Prediction prediction;
+	int leading = -1;
+	int trailing = 0;
+
+public:
+	ColumnDecoder(ColumnPrecision precision, const uint64_t *words,
+		      std::size_t count)
+		: bits{words, count}, width{stored_width(precision)},
+		  has_high{precision == ColumnPrecision::LONG_DOUBLE}
+	{
+		uint64_t code = bits.get(2);
+		if (code >= PREDICTIONS)
+			throw std::runtime_error("result archive column is "
+						 "damaged");
+		prediction = (Prediction) code;
+	}
+
+	ColumnBits get()
+	{
+		ColumnBits value = predict(previous, before, prediction, width);
+		value.high = previous.high;
+		if (has_high && bits.get(1))
+			value.high = bits.get(16);
+
+		if (bits.get(1)) {
+			uint64_t x;
+			if (!bits.get(1)) {
+				if (leading < 0)
+					throw std::runtime_error("result archive "
+								 "column is damaged");
+				x = bits.get(width - leading - trailing)
+					<< trailing;
+			} else {
+				leading = bits.get(6);
+				int length = bits.get(6) + 1;
+				trailing = width - leading - length;
+				if (trailing < 0)
+					throw std::runtime_error("result archive "
+								 "column is damaged");
+				x = bits.get(length) << trailing;
+			}
+			value.low = apply_residual(value.low, x, prediction,
+						   width);
+		}
+		before = previous;
+		previous = value;
+		return value;
+	}
+};
+
+static void put_bytes(std::vector<char> &bytes, const void *data,
+		      std::size_t length)
+{
+	const char *p = (const char *) data;
+	bytes.insert(bytes.end(), p, p + length);
+}
+
+// set in a chunk's mask when theta and lambda_naught are stored whole, as
+// long doubles, whatever their columns' precision and error bound
+static const uint32_t WHOLE_ROOTS = 1u << 31;
+
+/**
+ * @brief the stored columns of one chunk, each as a word count and words
+ * @param whole_roots store theta and lambda_naught as they are, so every
+ * other column rebuilds to the bits compton_evaluate() gave it
+ * @param mask set to the stored columns
+ */
+static std::vector<char> encode_columns(const ComptonResultValues *rows,
+					std::size_t n,
+					const ArchiveSettings &settings,
+					bool whole_roots, uint32_t &mask)
+{
+	// what the reader rebuilds later columns from: the stored values as
+	// it reads them, and rebuilt values before they are rounded to their
+	// column's precision, so a difference such as the electron energy
+	// never cancels between two rounded columns
+	std::vector<ComptonResultValues> basis(n);
+	std::vector<ColumnBits> stored(n);
+	std::vector<char> body;
+	mask = whole_roots ? WHOLE_ROOTS : 0;
+
+	for (std::size_t c = 0; c < RESULT_COLUMNS; ++c) {
+		ArchiveColumn column = settings.columns[c];
+		long double ComptonResultValues::*member = COLUMN_MEMBERS[c];
+		if (whole_roots && !DERIVABLE[c]) {
+			column.precision = ColumnPrecision::LONG_DOUBLE;
+			column.error = 0;
+		}
+
+		// a rebuilt value carries the rounding of theta and lambda
+		// into it, which is a fraction of them rather than of the
+		// value, so it is held to the error of the column's scale
+		bool rebuilt = column.derive && DERIVABLE[c];
+		long double tolerance = 0;
+		if (rebuilt && rebuild_tolerance(column) > 0) {
+			long double scale = 0;
+			for (std::size_t i = 0; i < n; ++i)
+				if (std::isfinite(rows[i].*member))
+					scale = std::max(scale,
+							 fabsl(rows[i].*member));
+			tolerance = rebuild_tolerance(column) * scale;
+		}
+		for (std::size_t i = 0; rebuilt && i < n; ++i) {
+			long double value = rebuild_column(c, basis[i]);
+			ColumnBits bits = to_bits(value, column.precision);
+			ColumnBits exact = to_bits(rows[i].*member,
+						   column.precision);
+			rebuilt = bits == exact || (tolerance > 0 &&
+				fabsl(from_bits(bits, column.precision)
+				      - from_bits(exact, column.precision))
+				<= tolerance);
+			basis[i].*member = value;
+		}
+		if (rebuilt)
+			continue;
+
+		// every prediction is tried, the smallest stream is kept
+		mask |= 1u << c;
+		std::vector<ColumnEncoder> encoders;
+		for (int p = 0; p < PREDICTIONS; ++p)
+			encoders.emplace_back(column.precision, (Prediction) p);
+		for (std::size_t i = 0; i < n; ++i) {
+			stored[i] = reduce(rows[i].*member, column,
+					   DERIVABLE[c] ? 0 : ROOT_GUARD_BITS);
+			basis[i].*member = from_bits(stored[i], column.precision);
+			for (ColumnEncoder &encoder : encoders)
+				encoder.put(stored[i]);
+		}
+		const std::vector<uint64_t> *smallest = &encoders[0].getWords();
+		for (const ColumnEncoder &encoder : encoders)
+			if (encoder.getWords().size() < smallest->size())
+				smallest = &encoder.getWords();
+		const std::vector<uint64_t> &words = *smallest;
+		uint64_t count = words.size();
+		put_bytes(body, &count, sizeof(count));
+		put_bytes(body, words.data(), count * sizeof(uint64_t));
+	}
+	return body;
+}
+
+/**
+ * @brief compresses one chunk: its row count, a bit mask of the stored
+ * columns, a checksum, then the stored columns. Near a root where a column
+ * such as the electron velocity is a square root, the rounding of theta
+ * and lambda_naught can move a rebuilt value past any tolerance, and a
+ * rounded sweep predicts less well than an exact one, so a chunk with
+ * reduced theta or lambda_naught is tried again with them whole and the
+ * smaller kept: a chunk is never bigger than its lossless one
+ */
+static std::vector<char> encode_chunk(const ComptonResultValues *rows,
+				      std::size_t n,
+				      const ArchiveSettings &settings)
+{
+	bool roots_reduced = false;
+	for (std::size_t c = 0; c < RESULT_COLUMNS; ++c)
+		if (!DERIVABLE[c])
+			roots_reduced = roots_reduced ||
+				settings.columns[c].precision !=
+				ColumnPrecision::LONG_DOUBLE ||
+				settings.columns[c].error > 0;
+
+	uint32_t mask;
+	std::vector<char> body = encode_columns(rows, n, settings, false, mask);
+	if (roots_reduced) {
+		uint32_t whole_mask;
+		std::vector<char> whole = encode_columns(rows, n, settings,
+							 true, whole_mask);
+		if (whole.size() < body.size()) {
+			body.swap(whole);
+			mask = whole_mask;
+		}
+	}
+
+	std::vector<char> bytes;
+	uint32_t count = n;
+	uint64_t checksum = fnv1a_hash(body.data(), body.size());
+	put_bytes(bytes, &count, sizeof(count));
+	put_bytes(bytes, &mask, sizeof(mask));
+	put_bytes(bytes, &checksum, sizeof(checksum));
+	bytes.insert(bytes.end(), body.begin(), body.end());
+	return bytes;
+}
+
+/**
+ * @brief decompresses one chunk
+ * @param expected the rows the index says the chunk has, checked before
+ * anything is allocated
+ */
+static std::vector<ComptonResultValues> decode_chunk(
+	const std::vector<char> &bytes, const ArchiveSettings &settings,
+	uint64_t expected)
+{
+	uint32_t n, mask;
+	uint64_t checksum;
+	const std::size_t header = sizeof(n) + sizeof(mask) + sizeof(checksum);
+	if (bytes.size() < header)
+		throw std::runtime_error("result archive chunk is damaged");
+	memcpy(&n, bytes.data(), sizeof(n));
+	memcpy(&mask, bytes.data() + sizeof(n), sizeof(mask));
+	memcpy(&checksum, bytes.data() + sizeof(n) + sizeof(mask),
+	       sizeof(checksum));
+	if (n != expected || n > (bytes.size() - header) * MAX_ROWS_PER_BYTE ||
+	    fnv1a_hash(bytes.data() + header, bytes.size() - header) != checksum)
+		throw std::runtime_error("result archive chunk is damaged");
+
+	// the words are copied out so they are aligned. Columns are rebuilt
+	// from basis, as the writer checked them, see encode_chunk()
+	std::vector<ComptonResultValues> rows(n), basis(n);
+	std::vector<uint64_t> words;
+	std::size_t position = header;
+	for (std::size_t c = 0; c < RESULT_COLUMNS; ++c) {
+		const ArchiveColumn &column = settings.columns[c];
+		long double ComptonResultValues::*member = COLUMN_MEMBERS[c];
+
+		if (!(mask & (1u << c))) {
+			if (!DERIVABLE[c])
+				throw std::runtime_error("result archive chunk "
+							 "is damaged");
+			for (uint32_t i = 0; i < n; ++i) {
+				basis[i].*member = rebuild_column(c, basis[i]);
+				rows[i].*member = from_bits(to_bits(
+					basis[i].*member, column.precision),
+					column.precision);
+			}
+			continue;
+		}
+
+		uint64_t count;
+		if (bytes.size() - position < sizeof(count))
+			throw std::runtime_error("result archive chunk is damaged");
+		memcpy(&count, bytes.data() + position, sizeof(count));
+		position += sizeof(count);
+		if ((bytes.size() - position) / sizeof(uint64_t) < count)
+			throw std::runtime_error("result archive chunk is damaged");
+		words.resize(count);
+		memcpy(words.data(), bytes.data() + position,
+		       count * sizeof(uint64_t));
+		position += count * sizeof(uint64_t);
+
+		// whole roots are rounded to their column's precision only
+		// in the rows handed back, the rest is rebuilt from them whole
+		if ((mask & WHOLE_ROOTS) && !DERIVABLE[c]) {
+			ColumnDecoder decoder(ColumnPrecision::LONG_DOUBLE,
+					      words.data(), count);
+			for (uint32_t i = 0; i < n; ++i) {
+				basis[i].*member = from_bits(decoder.get(),
+					ColumnPrecision::LONG_DOUBLE);
+				rows[i].*member = from_bits(to_bits(
+					basis[i].*member, column.precision),
+					column.precision);
+			}
+			continue;
+		}
+		ColumnDecoder decoder(column.precision, words.data(), count);
+		for (uint32_t i = 0; i < n; ++i)
+			rows[i].*member = basis[i].*member =
+				from_bits(decoder.get(), column.precision);
+	}
+	return rows;
+}
+
+static unsigned pool_size(unsigned threads, std::size_t jobs)
+{
+	if (threads == 0)
+		threads = std::max(1u, std::thread::hardware_concurrency());
+	return std::max<std::size_t>(1, std::min<std::size_t>(threads, jobs));
+}
+
+/**
+ * @brief runs job(0) to job(jobs - 1) on a pool of threads, passing on
+ * the first exception
+ */
+template <typename Job>
+static void run_pool(unsigned threads, std::size_t jobs, Job job)
+{
+	std::atomic<std::size_t> next{0};
+	std::mutex lock;
+	std::string error;
+	std::vector<std::thread> pool;
+	for (unsigned t = 0; t < pool_size(threads, jobs); ++t)
+		pool.emplace_back([&]() {
+			std::size_t i;
+			while ((i = next.fetch_add(1)) < jobs) {
+				try {
+					job(i);
+				} catch (const std::exception &e) {
+					std::lock_guard<std::mutex> guard(lock);
+					error = e.what();
+				}
+			}
+		});
+	for (std::thread &t : pool)
+		t.join();
+	if (!error.empty())
+		throw std::runtime_error(error);
+}
+
+ResultArchiveWriter::ResultArchiveWriter(const std::string &path,
+					 const ArchiveSettings &settings)
+	: out{path, std::ios::binary}, path{path}, settings{settings}
+{
+	if (!out)
+		throw std::runtime_error("could not write " + path);
+	if (settings.chunk_rows == 0 || settings.chunk_rows > UINT32_MAX)
+		throw std::invalid_argument("result archive chunks need 1 to "
+					    "2^32 - 1 rows");
+
+	uint32_t version = RESULT_ARCHIVE_VERSION;
+	uint32_t columns = RESULT_COLUMNS;
+	uint64_t chunk_rows = settings.chunk_rows;
+	writeBytes(ARCHIVE_MAGIC, sizeof(ARCHIVE_MAGIC));
+	writeBytes(&version, sizeof(version));
+	writeBytes(&columns, sizeof(columns));
+	writeBytes(&chunk_rows, sizeof(chunk_rows));
+	for (const ArchiveColumn &column : settings.columns) {
+		uint8_t precision = (uint8_t) column.precision;
+		uint8_t derive = column.derive;
+		double error = column.error;
+		writeBytes(&precision, sizeof(precision));
+		writeBytes(&derive, sizeof(derive));
+		writeBytes(&error, sizeof(error));
+	}
+}
+
+void ResultArchiveWriter::writeBytes(const void *data, std::size_t length)
+{
+	if (!out.write((const char *) data, length))
+		throw std::runtime_error("could not write " + path);
+	position += length;
+}
+
+void ResultArchiveWriter::write(const ComptonResultValues *values,
+				std::size_t n)
+{
+	pending.insert(pending.end(), values, values + n);
+	rows += n;
+	// enough full chunks to keep every thread busy
+	if (pending.size() >= settings.chunk_rows
+	    * pool_size(settings.threads, SIZE_MAX))
+		flushChunks(false);
+}
+
+void ResultArchiveWriter::write(const std::vector<ComptonResultValues> &values)
+{
+	write(values.data(), values.size());
+}
+
+/**
+ * @brief compresses the full chunks waiting in pending in parallel, and
+ * with all the last partial one too, then writes them in order
+ */
+void ResultArchiveWriter::flushChunks(bool all)
+{
+	std::size_t size = settings.chunk_rows;
+	std::size_t chunks = all ? (pending.size() + size - 1) / size
+		: pending.size() / size;
+	std::vector<std::vector<char>> encoded(chunks);
+	run_pool(settings.threads, chunks, [&](std::size_t k) {
+		std::size_t first = k * size;
+		std::size_t n = std::min(size, pending.size() - first);
+		encoded[k] = encode_chunk(pending.data() + first, n, settings);
+	});
+
+	for (const std::vector<char> &chunk : encoded) {
+		offsets.push_back(position);
+		writeBytes(chunk.data(), chunk.size());
+	}
+	pending.erase(pending.begin(), pending.begin()
+		      + std::min(pending.size(), chunks * size));
+}
+
+void ResultArchiveWriter::close()
+{
+	flushChunks(true);
+	uint64_t index = position;
+	uint64_t chunks = offsets.size();
+	writeBytes(offsets.data(), chunks * sizeof(uint64_t));
+	writeBytes(&chunks, sizeof(chunks));
+	writeBytes(&rows, sizeof(rows));
+	writeBytes(&index, sizeof(index));
+	writeBytes(ARCHIVE_END, sizeof(ARCHIVE_END));
+	out.close();
+	if (!out)
+		throw std::runtime_error("could not write " + path);
+}
+
+ResultArchiveReader::ResultArchiveReader(const std::string &path)
+	: path{path}
+{
+	std::ifstream in(path, std::ios::binary);
+	if (!in)
+		throw std::runtime_error("could not read " + path);
+
+	char magic[8];
+	uint32_t version, columns;
+	uint64_t chunk_rows;
+	in.read(magic, sizeof(magic));
+	in.read((char *) &version, sizeof(version));
+	in.read((char *) &columns, sizeof(columns));
+	in.read((char *) &chunk_rows, sizeof(chunk_rows));
+	if (!in || memcmp(magic, ARCHIVE_MAGIC, sizeof(magic)) != 0)
+		throw std::runtime_error(path + " is not a result archive");
+	if (version != RESULT_ARCHIVE_VERSION || columns != RESULT_COLUMNS)
+		throw std::runtime_error(path + " is from another version");
+	if (chunk_rows == 0 || chunk_rows > UINT32_MAX)
+		throw std::runtime_error(path + " is damaged");
+	file_settings.chunk_rows = chunk_rows;
+	for (ArchiveColumn &column : file_settings.columns) {
+		uint8_t precision, derive;
+		double error;
+		in.read((char *) &precision, sizeof(precision));
+		in.read((char *) &derive, sizeof(derive));
+		in.read((char *) &error, sizeof(error));
+		if (precision > (uint8_t) ColumnPrecision::FLOAT)
+			throw std::runtime_error(path + " is damaged");
+		column.precision = (ColumnPrecision) precision;
+		column.derive = derive;
+		column.error = error;
+	}
+	std::streamoff header = in.tellg();
+
+	// the footer says where the chunk index is
+	char end[8];
+	uint64_t chunks;
+	in.seekg(0, std::ios::end);
+	file_size = in.tellg();
+	if (!in || file_size < header + FOOTER_BYTES)
+		throw std::runtime_error(path + " is incomplete");
+	in.seekg(file_size - FOOTER_BYTES);
+	in.read((char *) &chunks, sizeof(chunks));
+	in.read((char *) &total_rows, sizeof(total_rows));
+	in.read((char *) &index_offset, sizeof(index_offset));
+	in.read(end, sizeof(end));
+	if (!in || memcmp(end, ARCHIVE_END, sizeof(end)) != 0)
+		throw std::runtime_error(path + " is incomplete");
+
+	// the footer is checked against the file before anything its size is
+	// allocated: the index fills the space between the data and the
+	// footer, and the rows fit in the chunks and in the data
+	uint64_t after_header = file_size - header - FOOTER_BYTES;
+	if (chunks > after_header / sizeof(uint64_t) ||
+	    index_offset != file_size - FOOTER_BYTES - chunks * sizeof(uint64_t)
+	    || index_offset < (uint64_t) header ||
+	    total_rows > (index_offset - header) * MAX_ROWS_PER_BYTE ||
+	    (total_rows + chunk_rows - 1) / chunk_rows != chunks)
+		throw std::runtime_error(path + " is damaged");
+
+	offsets.resize(chunks);
+	in.seekg(index_offset);
+	in.read((char *) offsets.data(), chunks * sizeof(uint64_t));
+	if (!in)
+		throw std::runtime_error("could not read " + path);
+	for (std::size_t k = 0; k < chunks; ++k)
+		if (offsets[k] < (uint64_t) header || offsets[k] > index_offset
+		    || (k > 0 && offsets[k] < offsets[k - 1]))
+			throw std::runtime_error(path + " is damaged");
+}
+
+std::vector<ComptonResultValues> ResultArchiveReader::readChunk(
+	std::size_t chunk) const
+{
+	if (chunk >= offsets.size())
+		throw std::out_of_range("no chunk " + std::to_string(chunk)
+					+ " in " + path);
+	uint64_t end = chunk + 1 < offsets.size() ? offsets[chunk + 1]
+		: index_offset;
+	std::vector<char> bytes(end - offsets[chunk]);
+	std::ifstream in(path, std::ios::binary);
+	in.seekg(offsets[chunk]);
+	in.read(bytes.data(), bytes.size());
+	if (!in)
+		throw std::runtime_error("could not read " + path);
+
+	uint64_t expected = std::min<uint64_t>(file_settings.chunk_rows,
+		total_rows - chunk * file_settings.chunk_rows);
+	return decode_chunk(bytes, file_settings, expected);
+}
+
+std::vector<ComptonResultValues> ResultArchiveReader::readAll(
+	unsigned threads) const
+{
+	std::vector<ComptonResultValues> rows(total_rows);
+	run_pool(threads, offsets.size(), [&](std::size_t k) {
+		std::vector<ComptonResultValues> chunk = readChunk(k);
+		std::copy(chunk.begin(), chunk.end(),
+			  rows.begin() + k * file_settings.chunk_rows);
+	});
+	return rows;
+}
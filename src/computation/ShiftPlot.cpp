@@ -0,0 +1,64 @@
+/**
+ * @file ShiftPlot.cpp
+ * @brief The Compton shift plot data and script, see ShiftPlot.hpp
+ */
+
+#include <ShiftPlot.hpp>
+#include <cmath>
+#include <cstdio>
+
+ShiftPlotData make_shift_plot(long double lambda_prime,
+			      long double lambda_naught,
+			      long double e_naught, long double e_prime,
+			      std::size_t samples)
+{
+	ShiftPlotData data;
+	if (samples < 2)
+		samples = 2;
+	data.x.resize(samples);
+	data.incident.resize(samples);
+	data.deflected.resize(samples);
+
+	long double b_value_naught = 2 * M_PI / lambda_naught;
+	long double b_value_prime = 2 * M_PI / lambda_prime;
+	for (std::size_t i = 0; i < samples; ++i) {
+		long double x = 2 * lambda_naught * i / (samples - 1);
+		data.x[i] = x;
+		data.incident[i] = e_naught * cos(b_value_naught * x);
+		data.deflected[i] = e_prime * cos(b_value_prime * x);
+	}
+	return data;
+}
+
+/**
+ * @brief appends one curve as '-' data, formatted with snprintf as it is
+ * run for thousands of plots at a time
+ */
+static void append_curve(std::string &script, const std::vector<double> &x,
+			 const std::vector<double> &y)
+{
+	char row[64];
+	for (std::size_t i = 0; i < x.size(); ++i) {
+		int n = snprintf(row, sizeof(row), "%.9g %.9g\n", x[i], y[i]);
+		script.append(row, n);
+	}
+	script += "e\n";
+}
+
+std::string shift_plot_script(const ShiftPlotData &data)
+{
+	std::string script;
+	script.reserve(data.x.size() * 60 + 256);
+	script += "set xlabel \"Wavelength (meters)\"\n"
+		"set ylabel \"Energy (joules)\"\n";
+
+	char range[64];
+	snprintf(range, sizeof(range), "set xrange [0:%.9g]\n",
+		 data.x.empty() ? 1.0 : data.x.back());
+	script += range;
+	script += "plot '-' with lines title \"Incident photon\", "
+		"'-' with lines title \"Deflected photon\"\n";
+	append_curve(script, data.x, data.incident);
+	append_curve(script, data.x, data.deflected);
+	return script;
+}
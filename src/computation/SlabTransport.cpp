@@ -0,0 +1,292 @@
+/**
+ * @file SlabTransport.cpp
+ * @brief Monte Carlo photon transport through a slab, chaining Compton
+ * collisions built on the formulas in ComptonKernel.hpp
+ */
+
+#include <SlabTransport.hpp>
+#include <ComptonKernel.hpp>
+#include <ComptonRandom.hpp>
+#include <algorithm>
+#include <atomic>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+// joules in one milli-electron volt, for the deposited energy tally
+const long double MILLI_ELECTRON_VOLT = 1.602176634E-22;
+
+SlabTally::SlabTally(const SlabSettings &settings) :
+	scatter_counts(settings.max_scatters + 1, 0),
+	transmitted_spectrum(settings.spectrum_bins, 0),
+	reflected_spectrum(settings.spectrum_bins, 0)
+{
+}
+
+/**
+ * @brief adds another tally to this one, the order doesn't matter
+ */
+void SlabTally::merge(const SlabTally &other)
+{
+	histories += other.histories;
+	transmitted += other.transmitted;
+	transmitted_unscattered += other.transmitted_unscattered;
+	reflected += other.reflected;
+	absorbed += other.absorbed;
+	scatters += other.scatters;
+	deposited_energy += other.deposited_energy;
+
+	scatter_counts.resize(std::max(scatter_counts.size(),
+				       other.scatter_counts.size()), 0);
+	for (std::size_t i = 0; i < other.scatter_counts.size(); ++i)
+		scatter_counts[i] += other.scatter_counts[i];
+
+	transmitted_spectrum.resize(std::max(transmitted_spectrum.size(),
+					     other.transmitted_spectrum.size()), 0);
+	for (std::size_t i = 0; i < other.transmitted_spectrum.size(); ++i)
+		transmitted_spectrum[i] += other.transmitted_spectrum[i];
+
+	reflected_spectrum.resize(std::max(reflected_spectrum.size(),
+					   other.reflected_spectrum.size()), 0);
+	for (std::size_t i = 0; i < other.reflected_spectrum.size(); ++i)
+		reflected_spectrum[i] += other.reflected_spectrum[i];
+}
+
+void SlabTally::save(CheckpointData &data) const
+{
+	data.putU64(histories);
+	data.putU64(transmitted);
+	data.putU64(transmitted_unscattered);
+	data.putU64(reflected);
+	data.putU64(absorbed);
+	data.putU64(scatters);
+	data.putU64(deposited_energy);
+	data.putU64s(scatter_counts);
+	data.putU64s(transmitted_spectrum);
+	data.putU64s(reflected_spectrum);
+}
+
+/**
+ * @brief replaces this tally with the one saved in data. The histograms
+ * must be the sizes this tally was made with.
+ */
+void SlabTally::load(CheckpointData &data)
+{
+	histories = data.getU64();
+	transmitted = data.getU64();
+	transmitted_unscattered = data.getU64();
+	reflected = data.getU64();
+	absorbed = data.getU64();
+	scatters = data.getU64();
+	deposited_energy = data.getU64();
+
+	std::vector<uint64_t> counts = data.getU64s();
+	std::vector<uint64_t> transmitted_bins = data.getU64s();
+	std::vector<uint64_t> reflected_bins = data.getU64s();
+	if (counts.size() != scatter_counts.size() ||
+	    transmitted_bins.size() != transmitted_spectrum.size() ||
+	    reflected_bins.size() != reflected_spectrum.size())
+		throw std::runtime_error("checkpoint histograms don't match the "
+					 "settings");
+	scatter_counts = counts;
+	transmitted_spectrum = transmitted_bins;
+	reflected_spectrum = reflected_bins;
+}
+
+/**
+ * @brief total Klein-Nishina cross-section (m^2) for one electron
+ */
+long double klein_nishina_total(long double lambda)
+{
+	long double k = COMPTON_WAVELENGTH / lambda; // E / m_0 c^2
+	long double log_term = log(1 + 2 * k);
+
+	return 2 * M_PI * ELECTRON_RADIUS * ELECTRON_RADIUS *
+		((1 + k) / (k * k) *
+		 (2 * (1 + k) / (1 + 2 * k) - log_term / k) +
+		 log_term / (2 * k) -
+		 (1 + 3 * k) / ((1 + 2 * k) * (1 + 2 * k)));
+}
+
+/**
+ * @brief samples cos(theta) from the Klein-Nishina distribution by
+ * rejection, the differential cross-section is at most r_e^2 (forward)
+ */
+static long double sample_cos_theta(long double lambda, ComptonRandom &rng)
+{
+	for (;;) {
+		long double cos_theta = 2 * rng.uniform() - 1;
+		long double lambda_prime = compton_lambda_prime(lambda, cos_theta);
+		long double sin_theta = sqrt(1 - cos_theta * cos_theta);
+		long double f = klein_nishina(lambda, lambda_prime, sin_theta) /
+			(ELECTRON_RADIUS * ELECTRON_RADIUS);
+		if (rng.uniform() < f)
+			return cos_theta;
+	}
+}
+
+/**
+ * @brief turns the direction (u, v, w) by theta and a uniform azimuth
+ */
+static void rotate_direction(long double &u, long double &v, long double &w,
+			     long double cos_theta, ComptonRandom &rng)
+{
+	long double sin_theta = sqrt(1 - cos_theta * cos_theta);
+	long double azimuth = 2 * M_PI * rng.uniform();
+	long double cos_phi = cos(azimuth), sin_phi = sin(azimuth);
+
+	if (fabs(w) > 0.99999L) {
+		u = sin_theta * cos_phi;
+		v = sin_theta * sin_phi;
+		w = w > 0 ? cos_theta : -cos_theta;
+		return;
+	}
+
+	long double temp = sqrt(1 - w * w);
+	long double u2 = sin_theta * (u * w * cos_phi - v * sin_phi) / temp
+		+ u * cos_theta;
+	long double v2 = sin_theta * (v * w * cos_phi + u * sin_phi) / temp
+		+ v * cos_theta;
+	w = -sin_theta * cos_phi * temp + w * cos_theta;
+	u = u2;
+	v = v2;
+}
+
+/**
+ * @brief adds an exit wavelength to a spectrum tally, anything past the
+ * range goes in the last bin
+ */
+static void tally_exit(std::vector<uint64_t> &spectrum,
+		       const SlabSettings &settings,
+		       long double lambda_naught, long double lambda)
+{
+	long double bin_width = settings.spectrum_range * pow(10, -12)
+		/ spectrum.size();
+	std::size_t bin = (std::size_t) ((lambda - lambda_naught) / bin_width);
+	spectrum[std::min(bin, spectrum.size() - 1)]++;
+}
+
+/**
+ * @brief runs the histories of one batch and adds them to tally. The
+ * energy deposited in the batch is summed in joules and rounded to meV
+ * once at the end, the same whichever thread ran the batch, so the tally
+ * doesn't depend on the thread count and isn't biased low by truncating
+ * every deposit.
+ */
+void run_slab_batch(const SlabSettings &settings, uint64_t batch,
+		    SlabTally &tally)
+{
+	ComptonRandom rng(settings.seed, batch);
+	uint64_t first = batch * SLAB_BATCH_SIZE;
+	uint64_t last = std::min(first + SLAB_BATCH_SIZE, settings.histories);
+	long double lambda_naught = settings.lambda_naught * pow(10, -12);
+	long double deposited = 0;
+
+	for (uint64_t history = first; history < last; ++history) {
+		long double lambda = lambda_naught;
+		long double z = 0, u = 0, v = 0, w = 1;
+		unsigned scatters = 0;
+
+		tally.histories++;
+		for (;;) {
+			long double compton = settings.electron_density *
+				klein_nishina_total(lambda);
+			long double total = compton + settings.absorption;
+			z += w * -log(rng.uniformPositive()) / total;
+
+			if (z > settings.thickness) {
+				tally.transmitted++;
+				if (scatters == 0)
+					tally.transmitted_unscattered++;
+				tally_exit(tally.transmitted_spectrum, settings,
+					   lambda_naught, lambda);
+				break;
+			}
+			if (z < 0) {
+				tally.reflected++;
+				tally_exit(tally.reflected_spectrum, settings,
+					   lambda_naught, lambda);
+				break;
+			}
+			if (rng.uniform() * total < settings.absorption ||
+			    scatters == settings.max_scatters) {
+				tally.absorbed++;
+				deposited += photon_energy(lambda);
+				break;
+			}
+
+			// Compton scatter, lambda prime is the next collision's
+			// lambda naught
+			long double cos_theta = sample_cos_theta(lambda, rng);
+			long double lambda_prime =
+				compton_lambda_prime(lambda, cos_theta);
+			deposited += electron_energy(lambda, lambda_prime);
+			rotate_direction(u, v, w, cos_theta, rng);
+			lambda = lambda_prime;
+			scatters++;
+		}
+		tally.scatters += scatters;
+		tally.scatter_counts[scatters]++;
+	}
+	tally.deposited_energy += llroundl(deposited / MILLI_ELECTRON_VOLT);
+}
+
+/**
+ * @brief runs batches [first, last) on a pool of threads. Threads take the
+ * next batch from an atomic counter and only touch their own tally.
+ */
+SlabTally run_slab_batches(const SlabSettings &settings, uint64_t first,
+			   uint64_t last)
+{
+	unsigned threads = settings.threads;
+	if (threads == 0)
+		threads = std::max(1u, std::thread::hardware_concurrency());
+
+	std::atomic<uint64_t> next{first};
+	std::vector<SlabTally> tallies(threads, SlabTally(settings));
+	std::vector<std::thread> pool;
+	for (unsigned t = 0; t < threads; ++t)
+		pool.emplace_back([&, t]() {
+			uint64_t batch;
+			while ((batch = next.fetch_add(1)) < last)
+				run_slab_batch(settings, batch, tallies[t]);
+		});
+
+	SlabTally total(settings);
+	for (unsigned t = 0; t < threads; ++t) {
+		pool[t].join();
+		total.merge(tallies[t]);
+	}
+	return total;
+}
+
+/**
+ * @brief the number of batches for settings.histories
+ */
+uint64_t slab_batch_count(const SlabSettings &settings)
+{
+	return (settings.histories + SLAB_BATCH_SIZE - 1) / SLAB_BATCH_SIZE;
+}
+
+/**
+ * @brief hashes the settings written as exact hexadecimal floats
+ */
+uint64_t slab_settings_fingerprint(const SlabSettings &settings)
+{
+	std::ostringstream text;
+	text << std::hexfloat << settings.lambda_naught << ' '
+	     << settings.thickness << ' ' << settings.electron_density << ' '
+	     << settings.absorption << ' ' << settings.max_scatters << ' '
+	     << settings.histories << ' ' << settings.seed << ' '
+	     << settings.spectrum_bins << ' ' << settings.spectrum_range;
+	std::string s = text.str();
+	return fnv1a_hash(s.data(), s.size());
+}
+
+/**
+ * @brief runs every history of settings
+ */
+SlabTally run_slab_transport(const SlabSettings &settings)
+{
+	return run_slab_batches(settings, 0, slab_batch_count(settings));
+}
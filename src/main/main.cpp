@@ -2,16 +2,88 @@
  * @file main.cpp
  * @author Oisin O'Connell
  * @date 25 Jun 2020
- * @brief main program, calls the function that creates the informational
- * window followed by the function that creates the calculation window
- * 
+ * @brief main program, runs one GtkApplication whose window is the
+ * calculation window. The informational window opens once the calculation
+ * window has been drawn, and again from its "About" button.
+ *
+ * The time from the start of the program to the first frame of the
+ * calculation window is printed as "Time to interactive (ms)". If
+ * COMPTON_STARTUP_LOG is set it is also appended to that file, and if
+ * COMPTON_EXIT_AFTER_STARTUP is set the program quits after the first
+ * frame, so "make startup_metric" can time it.
  */
 
 #include <ComptonEventWindow.hpp>
 #include <ComptonInformation.hpp>
+#include <chrono>
+#include <fstream>
+#include <iostream>
 
-int main()
+static const std::chrono::steady_clock::time_point program_start =
+	std::chrono::steady_clock::now();
+
+/**
+ * @brief opens the informational window over the calculation window
+ * @param win the calculation window
+ * @return G_SOURCE_REMOVE
+ */
+static gboolean open_information(GtkWidget *win)
+{
+	show_information_window(GTK_WINDOW(win));
+	return G_SOURCE_REMOVE;
+}
+
+/**
+ * @brief runs after the calculation window's first frame, records the time
+ * to interactive
+ * @param win the calculation window
+ * @param cr unused
+ * @param app the application
+ * @return FALSE, so the draw carries on
+ */
+static gboolean first_draw(GtkWidget *win, void *cr, GtkApplication *app)
+{
+	g_signal_handlers_disconnect_by_func(win, (gpointer) first_draw, app);
+	std::chrono::duration<double, std::milli> time =
+		std::chrono::steady_clock::now() - program_start;
+	std::cout << "Time to interactive (ms): " << time.count() << std::endl;
+
+	const char *log = g_getenv("COMPTON_STARTUP_LOG");
+	if (log)
+		std::ofstream(log, std::ios::app) << time.count() << '\n';
+	if (g_getenv("COMPTON_EXIT_AFTER_STARTUP"))
+		g_application_quit(G_APPLICATION(app));
+	else
+		g_idle_add((GSourceFunc) open_information, win);
+	return FALSE;
+}
+
+/**
+ * @brief creates and shows the calculation window
+ * @param app the application
+ * @param data unused
+ */
+static void activate(GtkApplication *app, gpointer data)
+{
+	// a second launch just raises the window that is already open
+	GtkWindow *open = gtk_application_get_active_window(app);
+	if (open) {
+		gtk_window_present(open);
+		return;
+	}
+
+	GtkWidget *win = create_calculation_window(app);
+	g_signal_connect_after(G_OBJECT(win), "draw", G_CALLBACK(first_draw),
+			       app);
+	gtk_widget_show_all(win);
+}
+
+int main(int argc, char **argv)
 {
-	create_information_window();
-	create_calculation_window();
+	GtkApplication *app = gtk_application_new("org.compton.simulator",
+						  G_APPLICATION_FLAGS_NONE);
+	g_signal_connect(app, "activate", G_CALLBACK(activate), NULL);
+	int status = g_application_run(G_APPLICATION(app), argc, argv);
+	g_object_unref(app);
+	return status;
 }
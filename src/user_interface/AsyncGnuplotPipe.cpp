@@ -0,0 +1,142 @@
+/**
+ * @file AsyncGnuplotPipe.cpp
+ * @brief AsyncGnuplotPipe member function definitions
+ */
+
+#include <AsyncGnuplotPipe.hpp>
+#include <algorithm>
+#include <iostream>
+#include <signal.h>
+
+AsyncGnuplotPipe::AsyncGnuplotPipe(bool persist) :
+	persist{persist}
+{
+	sem_init(&wakeup, 0, 0);
+	writer = std::thread(&AsyncGnuplotPipe::writerLoop, this);
+}
+
+/**
+ * @brief writes out whatever is still queued, then closes gnuplot
+ */
+AsyncGnuplotPipe::~AsyncGnuplotPipe()
+{
+	stopping = true;
+	sem_post(&wakeup);
+	writer.join();
+	sem_destroy(&wakeup);
+}
+
+void AsyncGnuplotPipe::sendLine(const std::string &text, bool useBuffer)
+{
+	if (useBuffer)
+		buffer.push_back(text + "\n");
+	else
+		frame += text + "\n";
+}
+
+void AsyncGnuplotPipe::sendEndOfData(unsigned repeatBuffer)
+{
+	for (unsigned i = 0; i < repeatBuffer; i++) {
+		for (auto& line : buffer)
+			frame += line;
+		frame += "e\n";
+	}
+	buffer.clear();
+}
+
+void AsyncGnuplotPipe::sendNewDataBlock()
+{
+	sendLine("\n", !buffer.empty());
+}
+
+/**
+ * @brief hands the current frame to the writer thread, or discards it if
+ * gnuplot has failed
+ */
+bool AsyncGnuplotPipe::sendFrame(bool replaceable)
+{
+	if (failed) {
+		frame.clear();
+		buffer.clear();
+		return false;
+	}
+	if (!frame.empty())
+		push(new Frame{std::move(frame), replaceable, nullptr});
+	frame.clear();
+	return true;
+}
+
+/**
+ * @brief lock-free push onto the pending list, then wakes the writer
+ * (sem_post doesn't block either)
+ */
+void AsyncGnuplotPipe::push(Frame *f)
+{
+	f->next = pending.load(std::memory_order_relaxed);
+	while (!pending.compare_exchange_weak(f->next, f,
+					      std::memory_order_release,
+					      std::memory_order_relaxed))
+		;
+	sem_post(&wakeup);
+}
+
+/**
+ * @brief the writer thread: starts gnuplot, then waits for frames and
+ * writes them oldest first, skipping replaceable frames that have a newer
+ * replaceable frame behind them
+ */
+void AsyncGnuplotPipe::writerLoop()
+{
+	// a gnuplot that was closed or killed must not take the program down
+	// with it, so SIGPIPE is blocked here and the write just fails
+	sigset_t set;
+	sigemptyset(&set);
+	sigaddset(&set, SIGPIPE);
+	pthread_sigmask(SIG_BLOCK, &set, NULL);
+
+	FILE *pipe = popen(persist ? "gnuplot -persist" : "gnuplot", "w");
+	if (!pipe) {
+		std::cout << "failed to open gnuplot!" << std::endl;
+		failed = true;
+	}
+
+	for (;;) {
+		while (sem_wait(&wakeup) != 0)
+			;
+		bool stop = stopping;
+
+		// take everything queued so far and put it back in order
+		Frame *newest = pending.exchange(nullptr, std::memory_order_acquire);
+		std::vector<Frame *> frames;
+		for (Frame *f = newest; f; f = f->next)
+			frames.push_back(f);
+		std::reverse(frames.begin(), frames.end());
+
+		bool newer_replaceable = false;
+		for (std::size_t i = frames.size(); i-- > 0;) {
+			Frame *f = frames[i];
+			if (f->replaceable && newer_replaceable) {
+				dropped++;
+				f->text.clear();
+			}
+			newer_replaceable |= f->replaceable;
+		}
+		for (Frame *f : frames) {
+			if (!failed && !f->text.empty()) {
+				// gnuplot has exited if it stops taking input
+				if (fputs(f->text.c_str(), pipe) < 0 ||
+				    fflush(pipe) != 0)
+					failed = true;
+				else
+					written++;
+			}
+			delete f;
+		}
+
+		if (stop && !pending.load())
+			break;
+	}
+
+	if (pipe)
+		pclose(pipe);
+}
@@ -11,16 +11,26 @@
  */
 
 #include <ComptonEventWindow.hpp>
+#include <map>
 
 namespace ComptonEventValues {
 	long double theta;
 	long double lambda_prime;
 };
 
+// the values the window opens with, and their results, calculated before
+// GTK starts so they are on screen in the first frame
+static const long double DEFAULT_THETA = 30;
+static const long double DEFAULT_LAMBDA = 10;
+static const ComptonResultValues default_results =
+	compton_evaluate(DEFAULT_THETA, DEFAULT_LAMBDA);
+
 /** 
  * @brief creates the window that allows user input to generate calculations
+ * @param app the application the window belongs to
+ * @return the window, not shown yet
  */
-void create_calculation_window()
+GtkWidget *create_calculation_window(GtkApplication *app)
 {
 	GtkWidget *win;
 	GtkWidget *scale, *theta_label;
@@ -30,20 +40,20 @@ void create_calculation_window()
 	
 	GtkWidget *theta_entry, *theta_entry_label;
 	GtkWidget *lambda_entry, *lambda_entry_label;
+	GtkWidget *element_entry, *element_entry_label, *element_entry_box;
 	GtkWidget *submit;
 	GtkAdjustment *adjustment;
 	GtkWidget *title_description;
-	
-	gtk_init(0, NULL);
 
-	// window setup
-	win = gtk_window_new(GTK_WINDOW_TOPLEVEL);
+	// window setup, the application quits when it is closed
+	win = gtk_application_window_new(app);
 	gtk_window_set_title(GTK_WINDOW (win),
 			     basename("Compton Scattering Simulator"));
 	gtk_window_set_default_size(GTK_WINDOW (win), 500, 100);
 	gtk_container_set_border_width(GTK_CONTAINER (win), 10);
-	g_signal_connect(G_OBJECT (win), "destroy",
-			 G_CALLBACK (gtk_main_quit), NULL);
+
+	// filled in as the widgets are made, passed to the callbacks
+	struct args *multi_arg = g_new0(struct args, 1);
 
 	// create the outermost box that we pack everything else into
 	outer_box = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 10);
@@ -63,7 +73,8 @@ void create_calculation_window()
 	gtk_box_pack_start(GTK_BOX(data_entry_box), title_description, FALSE, FALSE, 0);
 	
 	// create the scale and the label for it
-	adjustment = gtk_adjustment_new(30.0, 0.0, 360.0, 0.1, 10.0, 0.0);
+	adjustment = gtk_adjustment_new(DEFAULT_THETA, 0.0, 360.0, 0.1, 10.0,
+					0.0);
 	scale = gtk_scale_new(GTK_ORIENTATION_HORIZONTAL, adjustment);
 	gtk_scale_set_digits (GTK_SCALE (scale), 2);
 	gtk_scale_set_value_pos(GTK_SCALE (scale), GTK_POS_TOP);
@@ -78,7 +89,9 @@ void create_calculation_window()
 	// create the alternate textbox usable for theta entry and its label
 	theta_entry = gtk_entry_new();
 	theta_entry_label = gtk_label_new("Alternatively, enter the scatter angle manually:");
-	gtk_entry_set_text(GTK_ENTRY(theta_entry), "30.0");
+	gchar *theta_text = g_strdup_printf("%.1f", (double) DEFAULT_THETA);
+	gtk_entry_set_text(GTK_ENTRY(theta_entry), theta_text);
+	g_free(theta_text);
 	gtk_widget_set_halign(theta_entry, GTK_ALIGN_START);
 	theta_entry_box = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 10);
 	gtk_box_pack_start(GTK_BOX(theta_entry_box), theta_entry_label, FALSE, FALSE, 0);
@@ -88,7 +101,9 @@ void create_calculation_window()
 	// create the text box for lambda entry and its label
 	lambda_entry_box = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 10);
 	lambda_entry = gtk_entry_new();
-	gtk_entry_set_text(GTK_ENTRY(lambda_entry), "10");
+	gchar *lambda_text = g_strdup_printf("%g", (double) DEFAULT_LAMBDA);
+	gtk_entry_set_text(GTK_ENTRY(lambda_entry), lambda_text);
+	g_free(lambda_text);
 	lambda_entry_label = gtk_label_new("Enter the pre-collision photon wavelength (lambda) (picometers):");
 	gtk_widget_set_halign(lambda_entry, GTK_ALIGN_START);
 	
@@ -96,10 +111,55 @@ void create_calculation_window()
 	gtk_box_pack_start(GTK_BOX(lambda_entry_box), lambda_entry, TRUE, TRUE, 0);
 	gtk_box_pack_start(GTK_BOX(data_entry_box), lambda_entry_box, FALSE, FALSE, 0);
 
+	// create the text box for the bound electron's element, left empty
+	// for the usual free electron
+	element_entry_box = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 10);
+	element_entry = gtk_entry_new();
+	element_entry_label = gtk_label_new("Bound electron element (e.g. H), leave empty for a free electron:");
+	gtk_widget_set_halign(element_entry, GTK_ALIGN_START);
+
+	gtk_box_pack_start(GTK_BOX(element_entry_box), element_entry_label, FALSE, FALSE, 0);
+	gtk_box_pack_start(GTK_BOX(element_entry_box), element_entry, TRUE, TRUE, 0);
+	gtk_box_pack_start(GTK_BOX(data_entry_box), element_entry_box, FALSE, FALSE, 0);
 	
-	// create the submit button
+	// create the submit button, and the label that says what is wrong
+	// with the inputs or results
 	submit = gtk_button_new_with_label("Submit");
 	gtk_box_pack_start(GTK_BOX(data_entry_box), submit, TRUE, TRUE, 10);
+	multi_arg->status = gtk_label_new("");
+	gtk_box_pack_start(GTK_BOX(data_entry_box), multi_arg->status,
+			   FALSE, FALSE, 0);
+
+	// create the buttons for the angular plots, which all draw the same
+	// sweep over theta. The sweep is calculated once the window is up
+	// (see prepare_angular_sweep()).
+	multi_arg->plotter = new ScatterPlotter();
+
+	GtkWidget *view_box = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 10);
+	gtk_box_pack_start(GTK_BOX(view_box),
+			   gtk_label_new("Angular plots:"), FALSE, FALSE, 0);
+	const char *view_names[] = {"Lambda prime", "Electron angle",
+				    "Intensity", "3-D directions"};
+	const ScatterView views[] = {ScatterView::LAMBDA_PRIME,
+				     ScatterView::ELECTRON_PHI,
+				     ScatterView::INTENSITY,
+				     ScatterView::DIRECTIONS_3D};
+	for (int i = 0; i < 4; ++i) {
+		GtkWidget *view_button = gtk_button_new_with_label(view_names[i]);
+		struct view_args *view = g_new0(struct view_args, 1);
+		view->multi_arg = multi_arg;
+		view->view = views[i];
+		g_signal_connect(G_OBJECT(view_button), "clicked",
+				 G_CALLBACK(view_clicked), view);
+		gtk_box_pack_start(GTK_BOX(view_box), view_button, TRUE, TRUE, 0);
+	}
+	gtk_box_pack_start(GTK_BOX(data_entry_box), view_box, FALSE, FALSE, 0);
+
+	// the information window is only built when it is first shown
+	GtkWidget *about = gtk_button_new_with_label("About Compton scattering");
+	g_signal_connect_swapped(G_OBJECT(about), "clicked",
+				 G_CALLBACK(show_information_window), win);
+	gtk_box_pack_start(GTK_BOX(data_entry_box), about, FALSE, FALSE, 0);
 
 	// add the data entry box to the outer box
 	gtk_box_pack_start(GTK_BOX(outer_box), data_entry_box, FALSE, FALSE, 10);
@@ -114,6 +174,7 @@ void create_calculation_window()
 	GtkWidget *result_box = gtk_box_new(GTK_ORIENTATION_VERTICAL, 5);
 	struct result_labels *results = g_new0(struct result_labels, 1);
 	create_result_labels(outer_box, result_box, results);
+	set_result_labels(results, default_results);
 	gtk_box_pack_start(GTK_BOX(output_box), result_box, FALSE, FALSE, 0);
 	gtk_box_pack_start(GTK_BOX(outer_box), output_box, FALSE, FALSE, 10);
 	
@@ -128,19 +189,37 @@ void create_calculation_window()
 	g_signal_connect(G_OBJECT(lambda_entry), "insert-text",
 			 G_CALLBACK(insert_lambda_event), NULL);
 
-	// need to have a makeshift struct here to pass both of the args
-	// to the submit function
-	struct args *multi_arg = g_new0(struct args, 1);
 	multi_arg->lambda_val = lambda_entry;
 	multi_arg->theta_val = theta_entry;
+	multi_arg->element_val = element_entry;
 	multi_arg->results = results;
 	g_signal_connect(G_OBJECT(submit), "clicked",
 			 G_CALLBACK(submit_clicked),
 			 multi_arg);
+
+	// the angular sweep isn't needed for the first frame, so it is
+	// calculated when GTK is next idle
+	g_idle_add((GSourceFunc) prepare_angular_sweep, multi_arg);
 	
 	gtk_container_add(GTK_CONTAINER (win), outer_box);
-	gtk_widget_show_all(win);
-	gtk_main();
+	return win;
+}
+
+/**
+ * @brief calculates the angular sweep (0 to 360 degrees in 0.1 degree
+ * steps) for the default lambda, if it hasn't been already
+ * @param multi_arg the args holding the sweep and plotter
+ * @return G_SOURCE_REMOVE, so it runs once as an idle callback
+ */
+gboolean prepare_angular_sweep(struct args *multi_arg)
+{
+	if (!multi_arg->sweep) {
+		multi_arg->sweep = new ComptonSweep(0.0, 360.0, 3601,
+						    DEFAULT_LAMBDA);
+		multi_arg->plotter->setData
+			(make_scatter_plot_buffers(*multi_arg->sweep));
+	}
+	return G_SOURCE_REMOVE;
 }
 
 /**
@@ -156,10 +235,55 @@ void submit_clicked(GtkWidget *button, struct args *multi_arg)
 	GtkEntryBuffer *lambda_buf = gtk_entry_get_buffer
 		(GTK_ENTRY(multi_arg->lambda_val));
 	
+	GtkEntryBuffer *element_buf = gtk_entry_get_buffer
+		(GTK_ENTRY(multi_arg->element_val));
+	
 	const gchar *theta = gtk_entry_buffer_get_text(theta_buf);
 	const gchar *lambda = gtk_entry_buffer_get_text(lambda_buf);
+	const gchar *element = gtk_entry_buffer_get_text(element_buf);
+
+	// the entries only stop letters, so "" or "1.2.3" still get here
+	long double theta_value, lambda_value;
+	uint32_t status = 0;
+	if (!parse_entry_number(theta, theta_value))
+		status |= COMPTON_BAD_THETA;
+	if (!parse_entry_number(lambda, lambda_value))
+		status |= COMPTON_BAD_LAMBDA;
+	if (!status)
+		status = compton_status(theta_value, lambda_value,
+					compton_evaluate(theta_value,
+							 lambda_value));
+	gtk_label_set_text(GTK_LABEL(multi_arg->status),
+			   status_message(status).c_str());
+	if (status & (COMPTON_BAD_THETA | COMPTON_BAD_LAMBDA))
+		return;
+
+	ComptonEvent c{theta_value, lambda_value};
+	update_angular_sweep(multi_arg, lambda_value);
+
+	// bound electron: show the median of the broadened distribution
+	// and graph the whole distribution
+	if (element[0] != '\0') {
+		try {
+			const ComptonProfile &profile =
+				cached_compton_profile(element);
+			BinnedSpectrum broadened = profile.broadenedSpectrum
+				(theta_value, lambda_value, 200);
+			
+			graph_broadened_shift(broadened,
+					      c.getResults().lambda_prime,
+					      profile.getElement());
+			set_result_labels(multi_arg->results,
+					  compton_evaluate_bound(theta_value,
+								 lambda_value,
+								 profile, 0.5));
+			return;
+		} catch (const std::exception &e) {
+			std::cout << e.what()
+				  << ", using a free electron instead" << '\n';
+		}
+	}
 
-	ComptonEvent c{atof(theta), atof(lambda)};
 	ComptonGraphValues graph_vals = c.getComptonGraphValues();
 
 	graph_compton_shift(graph_vals.lambda_prime,
@@ -170,6 +294,76 @@ void submit_clicked(GtkWidget *button, struct args *multi_arg)
 	set_result_labels(multi_arg->results, c);
 }
 
+/**
+ * @brief reads a number typed into an entry
+ * @param text the entry's text
+ * @param value set to the number
+ * @return false unless the whole text is one number
+ */
+bool parse_entry_number(const gchar *text, long double &value)
+{
+	char *end;
+	value = strtold(text, &end);
+	return end != text && *end == '\0';
+}
+
+/**
+ * @brief what the status bits of a calculation mean, "" for none
+ * @param status COMPTON_* status bits, see compton_status()
+ */
+std::string status_message(uint32_t status)
+{
+	std::string message;
+	for (int b = 0; b < COMPTON_STATUS_BITS; ++b)
+		if (status & (1u << b))
+			message += (message.empty() ? "" : ", ")
+				+ std::string(compton_status_name(b));
+	return message;
+}
+
+/**
+ * @brief recalculates the angular sweep when lambda has changed, the angle
+ * terms of the sweep are reused
+ * @param multi_arg the sweep and plotter
+ * @param lambda the incident wavelength in picometers
+ */
+void update_angular_sweep(struct args *multi_arg, long double lambda)
+{
+	prepare_angular_sweep(multi_arg);
+	if (lambda == multi_arg->sweep->getLambda())
+		return;
+	multi_arg->sweep->setLambda(lambda);
+	multi_arg->plotter->setData
+		(make_scatter_plot_buffers(*multi_arg->sweep));
+}
+
+/**
+ * @brief draws one of the angular plots from the already calculated sweep
+ * @param button the view's button
+ * @param view the window's args and which view to draw
+ */
+void view_clicked(GtkWidget *button, struct view_args *view)
+{
+	prepare_angular_sweep(view->multi_arg);
+	view->multi_arg->plotter->show(view->view);
+}
+
+/**
+ * @brief loads the Compton profile for an element the first time it is
+ * used and keeps it for later submits
+ * @param element the element symbol typed by the user
+ */
+const ComptonProfile &cached_compton_profile(const std::string &element)
+{
+	static std::map<std::string, ComptonProfile> profiles;
+
+	auto it = profiles.find(element);
+	if (it == profiles.end())
+		it = profiles.emplace(element,
+				      load_compton_profile(element)).first;
+	return it->second;
+}
+
 /**
  * @brief prevents the entry of any non-numeric characters for lambda
  * @param scale the text box
@@ -288,8 +482,17 @@ void create_result_labels(GtkWidget *outer_box,
  */
 void set_result_labels(struct result_labels *results, ComptonEvent event)
 {
-	ComptonResultValues eventResult = event.getResults();
- 
+	set_result_labels(results, event.getResults());
+}
+
+/**
+ * @brief updates the result labels from already calculated values
+ * @param results all of the result label widgets in a struct
+ * @param eventResult the values to show
+ */
+void set_result_labels(struct result_labels *results,
+		       ComptonResultValues eventResult)
+{
 	std::stringstream theta_result;
 	theta_result << "Scattering angle (theta): "
 		     << std::setprecision(5)
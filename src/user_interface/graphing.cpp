@@ -8,50 +8,178 @@
  * @todo move headers out
  */
 
-#include <gnuplot.h>
+#include <algorithm>
 #include <cmath>
 #include <graphing.hpp>
 #include <sstream>
 
-
+/**
+ * @brief the gnuplot window shared by the Compton shift graphs. It stays
+ * open between submits and each graph replaces the last one. A gnuplot
+ * that couldn't start or has gone away is started again.
+ */
+static AsyncGnuplotPipe &shift_plot()
+{
+	static std::unique_ptr<AsyncGnuplotPipe> gp;
+	if (!gp || gp->hasFailed())
+		gp.reset(new AsyncGnuplotPipe());
+	return *gp;
+}
 
 void graph_compton_shift(long double lambda_prime,
 			 long double lambda_naught,
 			 long double e_naught,
 			 long double e_prime)
 {
-	system("killall gnuplot > /dev/null 2>&1");
-	GnuplotPipe gp;
-	
-	long double b_value_naught = 2 * M_PI / lambda_naught;
-	long double b_value_prime = 2 * M_PI / lambda_prime;
-	
-	gp.sendLine("set xlabel \"Wavelength (meters)\"");
-	gp.sendLine("set ylabel \"Energy (joules)\"");
-
-	std::ostringstream range_sstr;
-	range_sstr << "set xrange [0:" << lambda_naught * 2 << "]";
-	gp.sendLine(range_sstr.str());
-	
-	std::cout << "rangestr : " << range_sstr.str() << '\n';
-
-	std::ostringstream photon_naught_sstr;
-	photon_naught_sstr << "plot "
-			   << e_naught
-			   << " * cos("
-			   << b_value_naught
-			   << "*x) title \"Incident photon\"";
-
-	std::cout << "sstr1: "<< photon_naught_sstr.str() << '\n';
-	std::ostringstream photon_prime_sstr;
-	photon_prime_sstr << "replot "
-			  << e_prime
-			  << " * cos("
-			  << b_value_prime
-			  << "*x) title \"Deflected photon\"";
-
-	std::cout << "sstr2: " << photon_prime_sstr.str() << '\n';
-		
-	gp.sendLine(photon_naught_sstr.str());
-	gp.sendLine(photon_prime_sstr.str());
+	AsyncGnuplotPipe &gp = shift_plot();
+
+	gp.sendLine("reset");
+	gp.sendLine(shift_plot_script(make_shift_plot(lambda_prime,
+						      lambda_naught,
+						      e_naught, e_prime)));
+	gp.sendFrame();
+}
+
+/**
+ * @brief graphs the Doppler broadened distribution of the scattered
+ * wavelength for a bound electron, with the free electron wavelength
+ * marked for comparison
+ * @param broadened the distribution from ComptonProfile::broadenedSpectrum()
+ * @param lambda_prime the free electron scattered wavelength (meters)
+ * @param element the element the profile belongs to
+ */
+void graph_broadened_shift(const BinnedSpectrum &broadened,
+			   long double lambda_prime,
+			   const std::string &element)
+{
+	AsyncGnuplotPipe &gp = shift_plot();
+
+	long double peak = 0;
+	for (long double c : broadened.counts)
+		peak = std::max(peak, c);
+
+	gp.sendLine("reset");
+	gp.sendLine("set xlabel \"Scattered wavelength (meters)\"");
+	gp.sendLine("set ylabel \"Probability per bin\"");
+
+	std::ostringstream arrow_sstr;
+	arrow_sstr << "set arrow from " << lambda_prime << ",0 to "
+		   << lambda_prime << "," << peak << " nohead dashtype 2";
+	gp.sendLine(arrow_sstr.str());
+
+	gp.sendLine("plot '-' with lines title \"Bound electron (" + element
+		    + ")\", 1/0 dashtype 2 title \"Free electron\"");
+	for (std::size_t i = 0; i < broadened.counts.size(); ++i) {
+		std::ostringstream row;
+		row << broadened.binCenter(i) << ' ' << broadened.counts[i];
+		gp.sendLine(row.str());
+	}
+	gp.sendEndOfData();
+	gp.sendFrame();
+}
+
+/**
+ * @brief stores new sample buffers, they are only sent to gnuplot when a
+ * view is next shown
+ * @param buffers the buffers from make_scatter_plot_buffers()
+ */
+void ScatterPlotter::setData(ScatterPlotBuffers buffers)
+{
+	this->buffers = std::move(buffers);
+	dirty = true;
+}
+
+/**
+ * @brief sends the thinned out buffers as the $polar, $photons and
+ * $electrons datablocks, starting gnuplot the first time
+ */
+void ScatterPlotter::pushData()
+{
+	if (!gp || gp->hasFailed())
+		gp.reset(new AsyncGnuplotPipe());
+
+	std::vector<std::size_t> rows = downsample_indices(
+		{&buffers.lambda_prime, &buffers.electron_phi,
+		 &buffers.intensity}, max_points);
+	gp->sendLine("$polar << EOD");
+	for (std::size_t i : rows) {
+		std::ostringstream row;
+		row << buffers.theta[i] << ' ' << buffers.lambda_prime[i] << ' '
+		    << buffers.electron_phi[i] << ' ' << buffers.intensity[i];
+		gp->sendLine(row.str());
+	}
+	gp->sendLine("EOD");
+
+	// the 3-D view sweeps every kept row around the incident axis
+	rows = downsample_indices({&buffers.intensity},
+				  max_points / azimuth_steps);
+	const std::vector<float> *radial[] = {&buffers.photon_radial,
+					      &buffers.electron_radial};
+	const std::vector<float> *axial[] = {&buffers.photon_axial,
+					     &buffers.electron_axial};
+	const char *names[] = {"$photons << EOD", "$electrons << EOD"};
+	for (int k = 0; k < 2; ++k) {
+		gp->sendLine(names[k]);
+		for (std::size_t i : rows)
+			for (std::size_t j = 0; j < azimuth_steps; ++j) {
+				double azimuth = 2 * M_PI * j / azimuth_steps;
+				std::ostringstream row;
+				row << (*radial[k])[i] * cos(azimuth) << ' '
+				    << (*radial[k])[i] * sin(azimuth) << ' '
+				    << (*axial[k])[i];
+				gp->sendLine(row.str());
+			}
+		gp->sendLine("EOD");
+	}
+
+	// the views need the datablocks, so this frame is never dropped
+	gp->sendFrame(false);
+	dirty = false;
+}
+
+/**
+ * @brief draws one of the angular views from the loaded datablocks
+ * @param view which view to draw
+ */
+void ScatterPlotter::show(ScatterView view)
+{
+	if (buffers.theta.empty())
+		return;
+	// a failed gnuplot is started again with the data
+	if (dirty || !gp || gp->hasFailed())
+		pushData();
+
+	gp->sendLine("reset");
+	if (view == ScatterView::DIRECTIONS_3D) {
+		gp->sendLine("set view equal xyz");
+		gp->sendLine("set xlabel \"x\"");
+		gp->sendLine("set ylabel \"y\"");
+		gp->sendLine("set zlabel \"Incident direction (z)\"");
+		gp->sendLine("splot $photons using 1:2:3 with points pt 7 ps 0.3"
+			     " title \"Scattered photon (length = intensity)\", "
+			     "$electrons using 1:2:3 with points pt 7 ps 0.3"
+			     " title \"Recoil electron (length = energy share)\"");
+		gp->sendFrame();
+		return;
+	}
+
+	gp->sendLine("set polar");
+	gp->sendLine("set angles radians");
+	gp->sendLine("set grid polar");
+	gp->sendLine("set size square");
+	switch (view) {
+	case ScatterView::LAMBDA_PRIME:
+		gp->sendLine("plot $polar using 1:2 with lines"
+			     " title \"Lambda prime (picometers)\"");
+		break;
+	case ScatterView::ELECTRON_PHI:
+		gp->sendLine("plot $polar using 1:3 with lines"
+			     " title \"Electron scatter angle phi (degrees)\"");
+		break;
+	default:
+		gp->sendLine("plot $polar using 1:4 with lines"
+			     " title \"Klein-Nishina intensity (forward = 1)\"");
+		break;
+	}
+	gp->sendFrame();
 }
@@ -0,0 +1,94 @@
+/**
+ * @file c_abi_check.c
+ * @brief Checks the C interface of libcompton from C, linked against
+ * libcompton.a, run by make check. Prints what went wrong and exits with 1
+ * on a failure.
+ */
+
+#include <compton.h>
+#include <math.h>
+#include <stdio.h>
+
+static int failures = 0;
+
+static void expect(int ok, const char *what)
+{
+	if (!ok) {
+		fprintf(stderr, "c_abi_check: %s\n", what);
+		failures++;
+	}
+}
+
+static int close_to(double a, double b, double tolerance)
+{
+	return fabs(a - b) <= tolerance * fabs(b);
+}
+
+int main(void)
+{
+	/* a good row, theta = 0 (no electron angle), a NaN theta and a
+	 * negative wavelength */
+	double theta[4] = {90, 0, NAN, 30};
+	double lambda[4] = {10, 10, 10, -1};
+	long double theta_ld[4], lambda_ld[4];
+	compton_result out[4];
+	compton_result_ld out_ld[4];
+	uint32_t status[4], status_ld[4];
+	compton_error_counts counts;
+	double lambda_prime[4], cross_section[4];
+	size_t errors, i;
+	int b;
+
+	expect(compton_abi_version() == COMPTON_ABI_VERSION,
+	       "the library and header ABI versions differ");
+	for (b = 0; b < COMPTON_STATUS_NBITS; ++b)
+		expect(compton_status_text(b) != NULL,
+		       "every status bit should have a text");
+
+	errors = compton_batch_evaluate(theta, lambda, out, status, 4, &counts);
+	expect(errors == 3 && counts.rows == 3,
+	       "three of the four rows should have errors");
+	expect(status[0] == 0, "the 90 degree row should be valid");
+	expect(status[1] & COMPTON_STATUS_NONFINITE_RESULT,
+	       "theta = 0 has no electron angle");
+	expect(status[2] & COMPTON_STATUS_BAD_THETA,
+	       "a NaN theta should be flagged");
+	expect(status[3] & COMPTON_STATUS_BAD_LAMBDA,
+	       "a negative lambda should be flagged");
+	expect(counts.bits[0] == 1 && counts.bits[1] == 1,
+	       "the counts should match the status words");
+	expect(close_to(out[0].lambda_prime - out[0].lambda_naught,
+			2.4263e-12, 1e-4),
+	       "lambda should move by one Compton wavelength at 90 degrees");
+	expect(close_to(out[0].photon_energy_naught - out[0].photon_energy_prime,
+			out[0].electron_energy, 1e-9),
+	       "the photon's lost energy should go to the electron");
+
+	for (i = 0; i < 4; ++i) {
+		theta_ld[i] = theta[i];
+		lambda_ld[i] = lambda[i];
+	}
+	compton_batch_evaluate_ld(theta_ld, lambda_ld, out_ld, status_ld, 4,
+				  NULL);
+	for (i = 0; i < 4; ++i)
+		expect(status_ld[i] == status[i],
+		       "the long double rows should have the same status");
+	expect((double) out_ld[0].electron_velocity == out[0].electron_velocity,
+	       "the long double results should round to the double ones");
+
+	errors = compton_batch_lambda_prime(theta, lambda, lambda_prime, 4);
+	expect(errors == 2, "the NaN theta and negative lambda are invalid");
+	expect(lambda_prime[0] == out[0].lambda_prime,
+	       "lambda prime alone should match the full evaluation");
+
+	compton_batch_klein_nishina(theta, lambda, cross_section, 2);
+	expect(close_to(cross_section[1], 7.9407877e-30, 1e-6),
+	       "forward scattering should have the Thomson cross-section");
+	expect(cross_section[0] < cross_section[1],
+	       "scattering at 90 degrees should be less likely than forwards");
+
+	expect(compton_batch_evaluate(NULL, NULL, NULL, NULL, 0, &counts) == 0
+	       && counts.rows == 0, "an empty batch should have no errors");
+
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,343 @@
+#!/bin/sh
+# Behavioural checks of compton_batch and the computation core, run from
+# the top of the repo by "make check" once everything they use is built.
+# Each check prints PASS or FAIL, and the script exits with 1 if any failed.
+
+BATCH=./compton_batch
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+failures=0
+
+pass() { echo "PASS $1"; }
+fail() { echo "FAIL $1"; failures=$((failures + 1)); }
+
+# the value of a "Name: value" line of compton_batch output
+field() { sed -n "s/^ *$1: //p" "$2" | head -n 1; }
+
+# succeeds when |$1 - $2| <= $3 * |$2|
+close_to() {
+	awk -v a="$1" -v b="$2" -v t="$3" 'BEGIN {
+		d = a - b; if (d < 0) d = -d
+		m = b < 0 ? -b : b
+		exit !(d <= t * m) }'
+}
+
+# spectrum: scattering keeps the incident intensity, and at 90 degrees
+# each line moves by one Compton wavelength, 2.426 pm
+printf '10 1\n11 1\n' > "$WORK/lines.txt"
+if $BATCH spectrum --input "$WORK/lines.txt" --theta 90 --bins 400 \
+	--photon-out "$WORK/photon.txt" \
+	--electron-out "$WORK/electron.txt" > "$WORK/spectrum.log" &&
+   close_to "$(field 'Scattered photon intensity' "$WORK/spectrum.log")" 2 1e-9 &&
+   close_to "$(awk '{ s += $2 } END { print s }' "$WORK/photon.txt")" 2 1e-6 &&
+   close_to "$(awk '$2 > m { m = $2; w = $1 } END { print w }' \
+	"$WORK/photon.txt")" 12.4263e-12 1e-3; then
+	pass "spectrum conserves intensity and shifts lines"
+else
+	fail "spectrum conserves intensity and shifts lines"
+fi
+
+# profile: the broadened distribution is normalised, and for hydrogen it
+# is centred on the free electron's lambda prime
+if $BATCH profile --element H --profile-dir data/compton_profiles \
+	--out "$WORK/broadened.txt" --samples 100000 > "$WORK/profile.log" &&
+   close_to "$(awk '{ s += $2 } END { print s }' "$WORK/broadened.txt")" 1 1e-2 &&
+   free=$(field 'Free electron lambda prime (m)' "$WORK/profile.log") &&
+   close_to "$(field 'Median bound lambda prime (m)' "$WORK/profile.log")" \
+	"$free" 1e-3 &&
+   close_to "$(field 'Mean sampled lambda prime (m)' "$WORK/profile.log")" \
+	"$free" 1e-3; then
+	pass "profile broadening is normalised and centred"
+else
+	fail "profile broadening is normalised and centred"
+fi
+
+# transport: the same seed gives the same tallies and spectra on any number
+# of threads (300000 histories is 19 batches)
+transport_with_threads() {
+	$BATCH transport --threads "$1" --histories 300000 \
+		--transmitted-out "$WORK/transmitted-$1.txt" \
+		--reflected-out "$WORK/reflected-$1.txt" |
+		grep -v -e '^Time' -e 'per second' > "$WORK/transport-$1.log"
+}
+if transport_with_threads 1 && transport_with_threads 3 &&
+   transport_with_threads 8 &&
+   cmp -s "$WORK/transport-1.log" "$WORK/transport-3.log" &&
+   cmp -s "$WORK/transport-1.log" "$WORK/transport-8.log" &&
+   cmp -s "$WORK/transmitted-1.txt" "$WORK/transmitted-8.txt" &&
+   cmp -s "$WORK/reflected-1.txt" "$WORK/reflected-8.txt"; then
+	pass "transport is the same on 1, 3 and 8 threads"
+else
+	fail "transport is the same on 1, 3 and 8 threads"
+fi
+
+# sweep: a wavelength reached by updating the cached terms gives the same
+# rows as a sweep of that wavelength alone, and at 90 degrees lambda moves
+# by one Compton wavelength with the photon's lost energy going to the
+# electron
+if $BATCH sweep --theta-steps 181 --lambda 10,20 --out "$WORK/both.txt" \
+	> /dev/null &&
+   $BATCH sweep --theta-steps 181 --lambda 20 --out "$WORK/one.txt" \
+	> /dev/null &&
+   tail -n 181 "$WORK/both.txt" > "$WORK/updated.txt" &&
+   tail -n 181 "$WORK/one.txt" | cmp -s - "$WORK/updated.txt" &&
+   close_to "$(awk '$1 == 90 { print $3 - $2 }' "$WORK/one.txt")" \
+	2.4263e-12 1e-4 &&
+   close_to "$(awk '$1 == 90 { print $4 - $5 }' "$WORK/one.txt")" \
+	"$(awk '$1 == 90 { print $8 }' "$WORK/one.txt")" 1e-6; then
+	pass "sweep wavelength updates match fresh sweeps"
+else
+	fail "sweep wavelength updates match fresh sweeps"
+fi
+
+# plot buffers: built from a sweep and thinned without losing extremes
+if tests/plot_buffers_check; then
+	pass "plot buffers and level of detail"
+else
+	fail "plot buffers and level of detail"
+fi
+
+# serve: a client that pipelines 50000 requests while it reads gets every
+# response, in order and equal to the kernel's, even with the server
+# holding at most 4 KiB of responses for it
+$BATCH serve --socket "$WORK/serve.sock" --max-pending 4096 \
+	> "$WORK/serve.log" &
+server=$!
+for i in 1 2 3 4 5 6 7 8 9 10; do
+	[ -S "$WORK/serve.sock" ] && break
+	sleep 0.2
+done
+tests/serve_check "$WORK/serve.sock" > "$WORK/client.log"
+client=$?
+kill -TERM "$server"
+wait "$server"
+if [ "$client" -eq 0 ] &&
+   [ "$(field 'Requests' "$WORK/serve.log")" = 50000 ] &&
+   [ "$(field 'Rows with errors' "$WORK/serve.log")" = \
+	"$(field 'Rows with errors' "$WORK/client.log")" ]; then
+	pass "serve answers every request like the kernel"
+else
+	fail "serve answers every request like the kernel"
+fi
+
+# adaptive: over the default 0-180 degree range, where phi is 0/0 at
+# theta = 0, the refined curve is within the tolerance and needs fewer
+# evaluations than the uniform grid that is as accurate, at an X-ray and a
+# gamma ray wavelength
+adaptive_beats_uniform() {
+	$BATCH adaptive --lambda "$1" --tolerance 1e-4 --check 100001 \
+		> "$WORK/adaptive-$1.log" &&
+	awk -v e="$(field 'Max error against 100001 uniform angles' \
+		"$WORK/adaptive-$1.log")" \
+	    -v n="$(field 'Evaluations' "$WORK/adaptive-$1.log")" \
+	    -v u="$(field 'Uniform angles for the same error' \
+		"$WORK/adaptive-$1.log")" \
+	    'BEGIN { exit !(e != "" && e <= 1e-4 && u !~ />=/ && n < u + 0) }'
+}
+if adaptive_beats_uniform 10 && adaptive_beats_uniform 0.01; then
+	pass "adaptive sweeps beat uniform grids within the tolerance"
+else
+	fail "adaptive sweeps beat uniform grids within the tolerance"
+fi
+
+# checkpoints: a sweep killed outright, and a transport run stopped with
+# SIGTERM, carry on with --resume to exactly what an uninterrupted run gives
+# (if a run finishes before it is stopped, resuming has nothing to do)
+sweep_args="--theta-steps 100001 --lambda 10,20,30 --out $WORK/resumed.txt"
+$BATCH sweep $sweep_args --checkpoint "$WORK/sweep.ckpt" \
+	--checkpoint-interval 0 > /dev/null &
+run=$!
+sleep 0.5
+kill -KILL "$run" 2> /dev/null
+wait "$run" 2> /dev/null
+if $BATCH sweep $sweep_args --checkpoint "$WORK/sweep.ckpt" --resume |
+	grep -e '^Rows with errors' -e '^  ' > "$WORK/resumed-sweep.log" &&
+   $BATCH sweep --theta-steps 100001 --lambda 10,20,30 \
+	--out "$WORK/uninterrupted.txt" |
+	grep -e '^Rows with errors' -e '^  ' > "$WORK/uninterrupted-sweep.log" &&
+   cmp -s "$WORK/resumed.txt" "$WORK/uninterrupted.txt" &&
+   cmp -s "$WORK/resumed-sweep.log" "$WORK/uninterrupted-sweep.log"; then
+	pass "a killed sweep resumes to the same output and error counts"
+else
+	fail "a killed sweep resumes to the same output and error counts"
+fi
+
+# the tally lines of transport or merge output, without timings
+tally_lines() { grep -v -e '^Time' -e 'per second' -e 'Checkpoint' \
+	-e '^Resuming' -e '^Shards' -e '^Read and merged' > "$1"; }
+transport_args="--histories 3000000 --threads 2"
+$BATCH transport $transport_args --checkpoint "$WORK/transport.ckpt" \
+	> /dev/null &
+run=$!
+sleep 0.5
+kill -TERM "$run" 2> /dev/null
+wait "$run"
+if $BATCH transport $transport_args --checkpoint "$WORK/transport.ckpt" \
+	--resume --transmitted-out "$WORK/resumed-transmitted.txt" |
+	tally_lines "$WORK/resumed-transport.log" &&
+   $BATCH transport $transport_args \
+	--transmitted-out "$WORK/uninterrupted-transmitted.txt" |
+	tally_lines "$WORK/uninterrupted-transport.log" &&
+   cmp -s "$WORK/resumed-transport.log" "$WORK/uninterrupted-transport.log" &&
+   cmp -s "$WORK/resumed-transmitted.txt" \
+	"$WORK/uninterrupted-transmitted.txt"; then
+	pass "a stopped transport run resumes to the same tallies"
+else
+	fail "a stopped transport run resumes to the same tallies"
+fi
+
+# shards: a sweep split into shards that end partway through wavelengths,
+# run by two processes claiming shards at once, merges to the same file as
+# one sweep; a sharded transport run merges to the same tallies
+job="--theta-steps 1001 --lambda 10,20,30"
+if $BATCH shard-plan --job-dir "$WORK/sweep-job" --shards 7 $job \
+	> /dev/null &&
+   { $BATCH run-shard --job-dir "$WORK/sweep-job" > /dev/null &
+     $BATCH run-shard --job-dir "$WORK/sweep-job" > /dev/null; } &&
+   wait $! &&
+   $BATCH merge --job-dir "$WORK/sweep-job" --out "$WORK/merged.txt" \
+	> /dev/null &&
+   $BATCH sweep $job --out "$WORK/unsharded.txt" > /dev/null &&
+   cmp -s "$WORK/merged.txt" "$WORK/unsharded.txt"; then
+	pass "sharded sweeps merge to the same output"
+else
+	fail "sharded sweeps merge to the same output"
+fi
+
+if $BATCH shard-plan --job-dir "$WORK/transport-job" --job transport \
+	--shards 5 --histories 300000 > /dev/null &&
+   $BATCH run-shard --job-dir "$WORK/transport-job" > /dev/null &&
+   $BATCH merge --job-dir "$WORK/transport-job" \
+	--transmitted-out "$WORK/merged-transmitted.txt" |
+	tally_lines "$WORK/merged-transport.log" &&
+   $BATCH transport --histories 300000 \
+	--transmitted-out "$WORK/unsharded-transmitted.txt" |
+	tally_lines "$WORK/unsharded-transport.log" &&
+   cmp -s "$WORK/merged-transport.log" "$WORK/unsharded-transport.log" &&
+   cmp -s "$WORK/merged-transmitted.txt" \
+	"$WORK/unsharded-transmitted.txt"; then
+	pass "sharded transport merges to the same tallies"
+else
+	fail "sharded transport merges to the same tallies"
+fi
+
+# render: index.txt names a file for every case, in order. With gnuplot
+# every file is drawn; without it the run has to fail rather than leave
+# the plots missing
+printf '# file theta lambda\nshift_000000.svg 0 1\nshift_000001.svg 90 1\nshift_000002.svg 0 10\nshift_000003.svg 90 10\n' \
+	> "$WORK/index.txt"
+$BATCH render --theta 0,90 --lambda 1,10 --format svg --renderers 2 \
+	--out-dir "$WORK/plots" > /dev/null 2>&1
+rendered=$?
+if command -v gnuplot > /dev/null; then
+	for i in 0 1 2 3; do
+		[ -s "$WORK/plots/shift_00000$i.svg" ] || rendered=1
+	done
+	drawn=$([ "$rendered" -eq 0 ] && echo yes)
+else
+	drawn=$([ "$rendered" -ne 0 ] && echo yes)
+fi
+if [ "$drawn" = yes ] && cmp -s "$WORK/plots/index.txt" "$WORK/index.txt"; then
+	pass "render lists and draws every case"
+else
+	fail "render lists and draws every case"
+fi
+
+# the count on an "  n: status name" line of print_error_counts()
+status_count() {
+	awk -v s=": $1" 'substr($0, length($0) - length(s) + 1) == s {
+		print $1 + 0 }' "$2"
+}
+
+# row checks: every row of a bad wavelength is flagged, a good one only
+# at theta = 0 where the electron has no angle, and the asin argument
+# rounding past 1 at tiny angles is told apart from a bad row
+if $BATCH sweep --theta-steps 181 --lambda 10,-1,0 --out "$WORK/bad.txt" \
+	> "$WORK/bad.log" &&
+   [ "$(field 'Rows with errors' "$WORK/bad.log")" = 363 ] &&
+   [ "$(status_count 'lambda is not a positive number' \
+	"$WORK/bad.log")" = 362 ] &&
+   $BATCH sweep --theta-max 0.01 --theta-steps 1001 --lambda 0.01 \
+	--out "$WORK/tiny.txt" > "$WORK/tiny.log" &&
+   [ "$(status_count 'the electron angle is outside the domain of asin' \
+	"$WORK/tiny.log")" -gt 0 ] &&
+   [ -z "$(status_count 'lambda is not a positive number' \
+	"$WORK/tiny.log")" ]; then
+	pass "sweep rows are checked and counted"
+else
+	fail "sweep rows are checked and counted"
+fi
+
+# archives: a lossless archive unpacks to exactly the text a sweep writes,
+# one with an error bound is within it in theta and lambda_naught and
+# within it of each column's largest value in a chunk in the others, none
+# is bigger than the lossless one, and a truncated one is turned away with
+# an error
+sweep_job="--theta-steps 100001 --lambda 10,20"
+if $BATCH sweep $sweep_job --out "$WORK/rows.txt" \
+	--archive "$WORK/lossless.cra" --chunk-rows 4096 > /dev/null &&
+   $BATCH unpack --in "$WORK/lossless.cra" --out "$WORK/lossless.txt" \
+	> /dev/null &&
+   cmp -s "$WORK/rows.txt" "$WORK/lossless.txt" &&
+   $BATCH sweep $sweep_job --archive "$WORK/lossy.cra" --error 1e-6 \
+	--precision double --chunk-rows 4096 > /dev/null &&
+   $BATCH unpack --in "$WORK/lossy.cra" --out "$WORK/lossy.txt" \
+	> /dev/null &&
+   paste -d ' ' "$WORK/rows.txt" "$WORK/lossy.txt" | awk '
+	NR > 1 && !/nan|inf/ {
+		k = int((NR - 2) / 4096)
+		for (i = 1; i <= 11; i++) {
+			d[NR, i] = $i - $(i + 11)
+			if (d[NR, i] < 0) d[NR, i] = -d[NR, i]
+			m[NR, i] = $i < 0 ? -$i : $i
+			if (i > 2 && m[NR, i] > scale[k, i])
+				scale[k, i] = m[NR, i]
+		}
+	}
+	END {
+		for (key in d) {
+			split(key, at, SUBSEP)
+			k = int((at[1] - 2) / 4096)
+			m2 = at[2] > 2 ? scale[k, at[2]] : m[key]
+			if (d[key] > 1.001e-6 * m2) bad++
+		}
+		exit bad > 0
+	}'; then
+	pass "archives round trip within their error bounds"
+else
+	fail "archives round trip within their error bounds"
+fi
+smaller=0
+for options in "--error 1e-6 --precision double" "--precision double" \
+	"--precision float" "--error 1e-3 --precision float"; do
+	$BATCH sweep $sweep_job --archive "$WORK/reduced.cra" $options \
+		--chunk-rows 4096 > /dev/null &&
+	[ "$(wc -c < "$WORK/reduced.cra")" -le \
+	  "$(wc -c < "$WORK/lossless.cra")" ] && smaller=$((smaller + 1))
+done
+if [ "$smaller" -eq 4 ]; then
+	pass "lossy archives are no bigger than lossless ones"
+else
+	fail "lossy archives are no bigger than lossless ones"
+fi
+head -c 500000 "$WORK/lossless.cra" > "$WORK/truncated.cra"
+$BATCH unpack --in "$WORK/truncated.cra" --out "$WORK/truncated.txt" \
+	2> /dev/null
+if [ $? -eq 1 ]; then
+	pass "truncated archives are rejected"
+else
+	fail "truncated archives are rejected"
+fi
+
+# libcompton: the C interface evaluates and flags rows from a C program
+if tests/c_abi_check; then
+	pass "libcompton's C interface"
+else
+	fail "libcompton's C interface"
+fi
+
+if [ "$failures" -ne 0 ]; then
+	echo "$failures checks failed"
+	exit 1
+fi
+echo "All checks passed"
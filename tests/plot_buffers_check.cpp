@@ -0,0 +1,68 @@
+/**
+ * @file plot_buffers_check.cpp
+ * @brief Checks the angular plot buffers and their level of detail thinning,
+ * run by make check. Prints what went wrong and exits with 1 on a failure.
+ */
+
+#include <PlotBuffers.hpp>
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+static int failures = 0;
+
+static void expect(bool ok, const char *what)
+{
+	if (!ok) {
+		std::cerr << "plot_buffers_check: " << what << '\n';
+		failures++;
+	}
+}
+
+int main()
+{
+	// theta = 0 has no electron angle, so only the other 1800 rows are kept
+	ComptonSweep sweep(0, 180, 1801, 10);
+	ScatterPlotBuffers b = make_scatter_plot_buffers(sweep);
+	const std::vector<float> *columns[] = {
+		&b.theta, &b.lambda_prime, &b.electron_phi, &b.intensity,
+		&b.photon_radial, &b.photon_axial,
+		&b.electron_radial, &b.electron_axial};
+	bool sizes = true, finite = true;
+	for (const std::vector<float> *column : columns) {
+		sizes = sizes && column->size() == 1800;
+		for (float v : *column)
+			finite = finite && std::isfinite(v);
+	}
+	expect(sizes, "every buffer should have a row per finite sweep row");
+	expect(finite, "the buffers should only hold finite values");
+	expect(b.theta.front() > 0 && b.theta.back() == (float) M_PI,
+	       "the theta = 0 row should be dropped");
+	expect(*std::max_element(b.intensity.begin(), b.intensity.end()) <= 1,
+	       "the Klein-Nishina intensity should peak at 1, forwards");
+
+	std::vector<const std::vector<float> *> series = {
+		&b.lambda_prime, &b.intensity};
+	std::vector<std::size_t> keep = downsample_indices(series, 100);
+	expect(!keep.empty() && keep.size() <= 100,
+	       "the thinned rows should fit in max_points");
+	expect(std::is_sorted(keep.begin(), keep.end()) &&
+	       std::adjacent_find(keep.begin(), keep.end()) == keep.end(),
+	       "the thinned rows should be increasing");
+	expect(keep.front() == 0 && keep.back() == 1799,
+	       "the thinning should keep the first and last rows");
+	for (const std::vector<float> *s : series) {
+		std::size_t lo = std::min_element(s->begin(), s->end())
+			- s->begin();
+		std::size_t hi = std::max_element(s->begin(), s->end())
+			- s->begin();
+		expect(std::binary_search(keep.begin(), keep.end(), lo) &&
+		       std::binary_search(keep.begin(), keep.end(), hi),
+		       "the thinning should keep the extremes of every series");
+	}
+
+	std::vector<std::size_t> all = downsample_indices(series, 5000);
+	expect(all.size() == 1800, "short series should not be thinned");
+
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,119 @@
+/**
+ * @file serve_check.cpp
+ * @brief A client for checking the query server, run by make check against
+ * "compton_batch serve --socket path". A writer thread pipelines all the
+ * requests without waiting for answers while the main thread reads the
+ * responses, so the server holds back reading whenever the responses
+ * pending for the client pass its cap, and must still answer every
+ * request. Every response has to be the kernel's own result and status
+ * for the request, in order. Prints what went wrong and exits with 1 on a
+ * failure.
+ */
+
+#include <ComptonKernel.hpp>
+#include <ComptonProtocol.hpp>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+/**
+ * @brief the same number, counting every NaN as the same
+ */
+static bool same_value(double a, double b)
+{
+	return a == b || (std::isnan(a) && std::isnan(b));
+}
+
+int main(int argc, char **argv)
+{
+	if (argc != 2) {
+		std::cerr << "usage: serve_check socket\n";
+		return 1;
+	}
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	sockaddr_un address = {};
+	address.sun_family = AF_UNIX;
+	strncpy(address.sun_path, argv[1], sizeof(address.sun_path) - 1);
+	if (fd < 0 || connect(fd, (sockaddr *) &address, sizeof(address)) != 0) {
+		std::cerr << "serve_check: could not connect to " << argv[1]
+			  << '\n';
+		return 1;
+	}
+
+	// ordinary rows, then one of each kind of bad row
+	const std::size_t count = 50000;
+	std::vector<ComptonRequest> requests(count);
+	for (std::size_t i = 0; i < count; ++i) {
+		requests[i].id = (uint32_t) i;
+		requests[i].reserved = 0;
+		requests[i].theta = 180.0 * i / count;
+		requests[i].lambda_naught = 0.001 + i % 100;
+	}
+	requests[count - 3].theta = NAN;
+	requests[count - 2].lambda_naught = -1;
+	requests[count - 1].lambda_naught = 0;
+
+	std::vector<long double> theta(count), lambda(count);
+	for (std::size_t i = 0; i < count; ++i) {
+		theta[i] = requests[i].theta;
+		lambda[i] = requests[i].lambda_naught;
+	}
+	std::vector<ComptonResultValues> results(count);
+	std::vector<uint32_t> status(count);
+	ComptonErrorCounts errors = compton_evaluate_batch_checked(theta.data(),
+		lambda.data(), results.data(), status.data(), count);
+
+	std::thread writer([&] {
+		const char *bytes = (const char *) requests.data();
+		std::size_t size = count * sizeof(ComptonRequest);
+		while (size > 0) {
+			ssize_t n = write(fd, bytes, size);
+			if (n <= 0)
+				break;
+			bytes += n;
+			size -= n;
+		}
+	});
+
+	std::vector<ComptonResponse> responses(count);
+	char *bytes = (char *) responses.data();
+	std::size_t size = count * sizeof(ComptonResponse), got = 0;
+	while (got < size) {
+		ssize_t n = read(fd, bytes + got, size - got);
+		if (n <= 0)
+			break;
+		got += n;
+	}
+	writer.join();
+	close(fd);
+	if (got < size) {
+		std::cerr << "serve_check: only " << got / sizeof(ComptonResponse)
+			  << " of " << count << " responses arrived\n";
+		return 1;
+	}
+
+	std::size_t wrong = 0;
+	for (std::size_t i = 0; i < count; ++i) {
+		ComptonResponse expected;
+		encode_response(expected, (uint32_t) i, status[i], results[i]);
+		bool same = responses[i].id == expected.id &&
+			responses[i].status == expected.status;
+		for (int v = 0; v < COMPTON_RESPONSE_VALUES; ++v)
+			same = same && same_value(responses[i].values[v],
+						  expected.values[v]);
+		if (!same && wrong++ < 5)
+			std::cerr << "serve_check: response " << i
+				  << " differs from the kernel's\n";
+	}
+	if (wrong)
+		return 1;
+
+	std::cout << "Rows with errors: " << errors.rows << '\n';
+	return 0;
+}